@@ -2,7 +2,9 @@
 
 
 #include "CVProcessor.h"
-#include "DNNConfig.h"
+#include "ImageConvert.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
 
 // Sets default values
 ACVProcessor::ACVProcessor()
@@ -16,14 +18,14 @@ ACVProcessor::ACVProcessor()
 	FString Yolov5ModelPath = NetworkPath + "yolov5s.onnx";
 	FString Yolov5ClassPath = NetworkPath + "class.names";
 	this->Yolov5Net = readNet(TCHAR_TO_UTF8(*Yolov5ModelPath));
-	Anchors = (float*) Anchors640;
     if (Yolov5Net.empty())
     {
-	    UE_LOG(LogTemp, Warning, TEXT("Yolov5Net Did Not Load!!!"));
+	    UE_LOG(LogVision, Error, TEXT("Yolov5Net Did Not Load!!!"));
     }
     else
     {
-	    UE_LOG(LogTemp, Warning, TEXT("Yolov5Net Loaded!!!"));
+	    UE_LOG(LogVision, Log, TEXT("Yolov5Net Loaded!!!"));
+	    Yolov5OutNames = GetOutputsNames(Yolov5Net);
     }
 
 	/* Yolov3 Model */
@@ -33,21 +35,97 @@ ACVProcessor::ACVProcessor()
 	this->Yolov3Net = readNetFromDarknet(TCHAR_TO_UTF8(*Yolov3CfgPath), TCHAR_TO_UTF8(*Yolov3WeightPath));
 	this->Yolov3Net.setPreferableBackend(cv::dnn::Backend::DNN_BACKEND_OPENCV);
 	this->Yolov3Net.setPreferableTarget(cv::dnn::Target::DNN_TARGET_CPU);
+	if (!Yolov3Net.empty())
+	{
+		Yolov3OutNames = GetOutputsNames(Yolov3Net);
+	}
+	// Only bodies are kept, so only the person column is read
+	const vector<string> Yolov3Classes = LoadClassNames(Yolov3ClassPath);
+	const auto Person = find(Yolov3Classes.begin(), Yolov3Classes.end(), "person");
+	Yolov3PersonClass = Person != Yolov3Classes.end() ? static_cast<int>(Person - Yolov3Classes.begin()) : 0;
 
 	/* ResNet SSD Model */
 	FString ResSSDModelPath = NetworkPath + "res10_300x300_ssd_iter_140000_fp16.caffemodel";
 	FString ResSSDProtoPath = NetworkPath + "deploy.prototxt";
-	UE_LOG(LogTemp, Warning, TEXT("file: %s"), *ResSSDModelPath);
+	UE_LOG(LogVision, Log, TEXT("file: %s"), *ResSSDModelPath);
 	this->SSDResNet = readNetFromCaffe(TCHAR_TO_UTF8(*ResSSDProtoPath), TCHAR_TO_UTF8(*ResSSDModelPath));
 	this->SSDResNet.setPreferableBackend(DNN_BACKEND_OPENCV);
 	this->SSDResNet.setPreferableTarget(DNN_TARGET_CPU);
+
+	/* Detection Buffers */
+	RawDetections.Reserve(MaxRawDetections);
+	Yolov5Result.Reserve(MaxDetections);
+	Yolov3Result.Reserve(MaxDetections);
+	SSDResResult.Reserve(MaxDetections);
+	Yolov5Candidates.Reserve(MaxDetections);
+	Yolov5Tracks.Reserve(MaxDetections);
+	Detections.Reserve(MaxDetections);
+	DispatchedDetections.Reserve(MaxDetections);
+	Results.ForEachSlot([](FDetectionSnapshot& Snapshot)
+	{
+		Snapshot.Yolov5.Reserve(MaxDetections);
+		Snapshot.Yolov3.Reserve(MaxDetections);
+		Snapshot.SSDRes.Reserve(MaxDetections);
+		Snapshot.Yolov5Tracks.Reserve(MaxDetections);
+	});
+
+	/* Profiling */
+	Yolov5Profile = Profiler.RegisterNet(TEXT("Yolov5"), Yolov5Net);
+	Yolov3Profile = Profiler.RegisterNet(TEXT("Yolov3"), Yolov3Net);
+	SSDResProfile = Profiler.RegisterNet(TEXT("SSDRes"), SSDResNet);
 }
 
 // Called when the game starts or when spawned
 void ACVProcessor::BeginPlay()
 {
 	Super::BeginPlay();
-	if (!UseTCP)
+	if (TimelineCaptureSeconds > 0.f)
+	{
+		CaptureTimeline(TimelineCaptureSeconds);
+	}
+	// The reader thread is not running yet, so the config is taken over directly
+	const FString ConfigPath = GetPipelineConfigPath();
+	if (PipelineConfig.LoadFromFile(ConfigPath))
+	{
+		UE_LOG(LogVision, Log, TEXT("Pipeline Config Loaded: %s"), *ConfigPath);
+	}
+	PipelineConfig.Validate();
+	PipelineConfigTime = IFileManager::Get().GetTimeStamp(*ConfigPath);
+	ActiveConfig = PipelineConfig;
+	AppliedConfig = PipelineConfig;
+	ConfigureScheduler();
+	ConfigureTracker();
+	FVisionLatency::Get().SetWindow(LatencyWindowSeconds);
+	bShowNativeImplemented = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ACVProcessor, ShowNativeImage));
+	// Garbage collection cost, to compare the preview upload paths by
+	PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddLambda([this]()
+	{
+		GarbageCollectStart = FPlatformTime::Cycles64();
+	});
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddLambda([this]()
+	{
+		++GarbageCollections;
+		LastGarbageCollectMs = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - GarbageCollectStart));
+	});
+	bShowYolov5ResultImplemented = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ACVProcessor, ShowYolov5Result));
+	bShowYolov5TracksImplemented = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ACVProcessor, ShowYolov5Tracks));
+	if (bPublishDetections)
+	{
+		DetectionStream = MakeUnique<FDetectionPublisher>();
+		if (!DetectionStream->Start(DetectionGroup, DetectionPort))
+		{
+			DetectionStream.Reset();
+		}
+	}
+	if (!FrameRingName.IsEmpty())
+	{
+		StartFrameRing();
+	}
+	else if (PipelineConfig.UseTCP)
+	{
+		StartFrameIngest();
+	}
+	else
 	{
 		InitCameraAndThreadRunnable(0);
 	}
@@ -57,44 +135,172 @@ void ACVProcessor::BeginPlay()
 void ACVProcessor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	VISION_SCOPED_STAGE(Tick);
+
+	Profiler.DrawOnScreen();
+
+	const double Now = FPlatformTime::Seconds();
+	PollPipelineConfig(Now);
+	// Edits of the UPROPERTY from Blueprint or the details panel are picked up like an ApplyPipelineConfig
+	if (!PipelineConfig.Equals(AppliedConfig))
+	{
+		ApplyPipelineConfig(PipelineConfig);
+	}
+
+	bPreviewWanted.store(bShowNativeImplemented || OnPreviewFrame.IsBound(), std::memory_order_relaxed);
+	NativeSubmitUs = NativeTexture.GetSubmitUs();
+	NativeTexturesCreated = NativeTexture.GetCreatedCount();
+	NativeFramesDropped = NativeTexture.GetDroppedCount();
+	LiveObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	Yolov5Rate = Scheduler.GetAchievedHz(EVisionModel::Yolov5Head);
+	Yolov3Rate = Scheduler.GetAchievedHz(EVisionModel::Yolov3Body);
+	SSDResRate = Scheduler.GetAchievedHz(EVisionModel::SSDResFace);
+	CaptureRate = CaptureHz.load(std::memory_order_relaxed);
+	VISION_SET_FLOAT_COUNTER(CaptureFps, CaptureRate);
+	VISION_SET_FLOAT_COUNTER(Yolov5Fps, Yolov5Rate);
+	VISION_SET_FLOAT_COUNTER(Yolov3Fps, Yolov3Rate);
+	VISION_SET_FLOAT_COUNTER(SSDResFps, SSDResRate);
+	VISION_SET_DWORD_COUNTER(DroppedInferences, Scheduler.GetDroppedCount(EVisionModel::Yolov5Head)
+		+ Scheduler.GetDroppedCount(EVisionModel::Yolov3Body) + Scheduler.GetDroppedCount(EVisionModel::SSDResFace));
+	VISION_SET_DWORD_COUNTER(DroppedPreviews, NativeFramesDropped);
+	VISION_SET_DWORD_COUNTER(QueueDepth, NativeTexture.GetInFlight());
+	VISION_SET_DWORD_COUNTER(TexturesCreated, NativeTexturesCreated);
+	VISION_SET_DWORD_COUNTER(LiveObjects, LiveObjects);
+	VISION_SET_FLOAT_COUNTER(GarbageCollectMs, LastGarbageCollectMs);
+	if (Now - LastRateReport > 5.0)
+	{
+		LastRateReport = Now;
+		UE_LOG(LogVision, Log, TEXT("Capture Rate: %.1f Hz"), CaptureRate);
+		if (FrameIngest)
+		{
+			// Other actors read the same server, so the window is this actor's own
+			const FFrameIngestServer::FStats IngestStats = FrameIngest->GetStats();
+			const FFrameIngestServer::FRates Ingest = FFrameIngestServer::GetRates(LastIngestStats, IngestStats);
+			LastIngestStats = IngestStats;
+			IngestRate = Ingest.FramesPerSecond;
+			IngestDropped = IngestStats.Dropped;
+			const FVisionLatencyStats IngestLatency = FVisionLatency::Get().GetStats(EVisionStage::Ingest);
+			UE_LOG(LogVision, Log, TEXT("Frame Ingest: %.1f fps, %.1f MB/s, %.2f ms Decode, p99 %.1f ms To Ready, %d Dropped, %d Connections"),
+				Ingest.FramesPerSecond, Ingest.MegabytesPerSecond, Ingest.DecodeMs, IngestLatency.P99Ms, IngestStats.Dropped, IngestStats.Connections);
+		}
+		if (DetectionStream)
+		{
+			UE_LOG(LogVision, Log, TEXT("Detection Stream: %d Published, %d Sent"), DetectionStream->GetPublishedCount(), DetectionStream->GetSentCount());
+		}
+		UE_LOG(LogVision, Log, TEXT("Model Rates: Yolov5 %.1f Hz (%.1f ms, %d dropped), Yolov3 %.1f Hz (%.1f ms, %d dropped), SSDRes %.1f Hz (%.1f ms, %d dropped)"),
+			Yolov5Rate, Scheduler.GetAverageCostMs(EVisionModel::Yolov5Head), Scheduler.GetDroppedCount(EVisionModel::Yolov5Head),
+			Yolov3Rate, Scheduler.GetAverageCostMs(EVisionModel::Yolov3Body), Scheduler.GetDroppedCount(EVisionModel::Yolov3Body),
+			SSDResRate, Scheduler.GetAverageCostMs(EVisionModel::SSDResFace), Scheduler.GetDroppedCount(EVisionModel::SSDResFace));
+		if (PipelineConfig.TrackYolov5)
+		{
+			UE_LOG(LogVision, Log, TEXT("Tracker: %d Tracks, %.1f us, Prediction Error %.1f px (%.1f px Held)"),
+				Yolov5TrackCount, Tracker.GetLastCostUs(), Tracker.GetPredictionErrorPx(), Tracker.GetHoldErrorPx());
+		}
+		UE_LOG(LogVision, Log, TEXT("Native Texture%s: %.1f us Submit, %d Created, %d Dropped, %d Garbage Collections (Last %.1f ms), %d UObjects"),
+			PipelineConfig.LegacyPreviewUpload ? TEXT(" (Legacy)") : TEXT(""), NativeSubmitUs, NativeTexturesCreated, NativeFramesDropped, GarbageCollections, LastGarbageCollectMs, LiveObjects);
+		const FVisionLatencyStats EndToEnd = FVisionLatency::Get().GetStats(EVisionStage::EndToEnd);
+		UE_LOG(LogVision, Log, TEXT("End-to-End Latency: p50 %.1f ms, p99 %.1f ms, Max %.1f ms"), EndToEnd.P50Ms, EndToEnd.P99Ms, EndToEnd.MaxMs);
+	}
+
+	// Take the newest complete result of the reader thread, the snapshot stays untouched until the next Acquire
+	if (Results.Acquire())
+	{
+		const FDetectionSnapshot& Snapshot = Results.Read();
+		Yolov5Count = Snapshot.Yolov5.Count;
+		Yolov3Count = Snapshot.Yolov3.Count;
+		SSDResCount = Snapshot.SSDRes.Count;
+		Yolov5TrackCount = Snapshot.Yolov5Tracks.Count;
+		ResultSequence = static_cast<int64>(Snapshot.Sequence);
+		ResultCaptureTime = Snapshot.CaptureTime;
+		VISION_TIMELINE_FLOW_END("Result", Snapshot.Sequence);
+		FVisionLatency::Get().Record(EVisionStage::EndToEnd, static_cast<uint64>(FMath::Max(0.0, Now - Snapshot.CaptureTime) * 1e9));
+		VISION_SET_DWORD_COUNTER(Heads, Yolov5Count);
+		VISION_SET_DWORD_COUNTER(Tracks, Yolov5TrackCount);
+	}
+	ResultAgeMs = ResultCaptureTime > 0.0 ? static_cast<float>((Now - ResultCaptureTime) * 1000.0) : 0.f;
+
+	if (PipelineConfig.TrackYolov5)
+	{
+		TrackerCostUs = Tracker.GetLastCostUs();
+		PredictionErrorPx = Tracker.GetPredictionErrorPx();
+		HoldErrorPx = Tracker.GetHoldErrorPx();
+	}
 
-	if (Yolov5Count)
+	// Blueprint only hears about the heads when they moved or changed, identical results are not dispatched again
+	const FDetectionSnapshot& Latest = Results.Read();
+	BuildDetections(Latest, Now);
+	if (HaveDetectionsChanged())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Detected Heads: %d"), Yolov5Count);
-		TArray<float> xArray;
-		TArray<float> yArray;
-		TArray<float> wArray;
-		TArray<float> hArray;
-		for (int i = 0; i < Yolov5Result.boxes.size(); ++i)
+		DispatchedDetections = Detections;
+		++DetectionsVersion;
+		OnDetectionsChanged(Detections);
+
+		if (bShowYolov5ResultImplemented)
+		{
+			Latest.Yolov5.CopyColumn(Latest.Yolov5.CenterX, CenterXArray);
+			Latest.Yolov5.CopyColumn(Latest.Yolov5.CenterY, CenterYArray);
+			ShowYolov5Result(Yolov5Count, CenterXArray, CenterYArray);
+		}
+		if (Latest.bTracked && bShowYolov5TracksImplemented)
 		{
-			xArray.Add(Yolov5Result.center[i][0]);
-			yArray.Add(Yolov5Result.center[i][1]);
-			UE_LOG(LogTemp, Warning, TEXT("Detected At X %f, Y %f."), Yolov5Result.center[i][0], Yolov5Result.center[i][1]);
-			UE_LOG(LogTemp, Warning, TEXT("Detected Size W %f, H %f."), Yolov5Result.size[i][0], Yolov5Result.size[i][1]);
+			TrackIDArray.SetNumUninitialized(Detections.Num(), false);
+			TrackXArray.SetNumUninitialized(Detections.Num(), false);
+			TrackYArray.SetNumUninitialized(Detections.Num(), false);
+			for (int32 i = 0; i < Detections.Num(); ++i)
+			{
+				TrackIDArray[i] = Detections[i].ID;
+				TrackXArray[i] = Detections[i].Center.X;
+				TrackYArray[i] = Detections[i].Center.Y;
+			}
+			ShowYolov5Tracks(Yolov5TrackCount, TrackIDArray, TrackXArray, TrackYArray);
 		}
-		ShowYolov5Result(Yolov5Count, xArray, yArray);
 	}
-	if (UseYolov3)
+	if (PipelineConfig.UseYolov3)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Detected Bodies: %d"), Yolov3Count);
 		ShowYolov3Result(Yolov3Count);
 	}
-	if (UseSSDRes)
+	if (PipelineConfig.UseSSDRes)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Detected Faces: %d"), SSDResCount);
 		// TODO: Show ResNet SSD Result
 	}
 }
 
+FVisionLatencyStats ACVProcessor::GetStageLatency(EVisionStage Stage) const
+{
+	return FVisionLatency::Get().GetStats(Stage);
+}
+
+bool ACVProcessor::CaptureTimeline(float Seconds)
+{
+	return FVisionTimeline::Get().StartCapture(Seconds, FVisionTimeline::MakeCapturePath());
+}
+
+bool ACVProcessor::DumpStageLatency(const FString& Path) const
+{
+	return FVisionLatency::Get().DumpJson(Path.IsEmpty()
+		? FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("VisionLatency-%s.json"), *FDateTime::Now().ToString())
+		: Path);
+}
+
 void ACVProcessor::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
 	if (ReadThread)
 	{
-		ReadThread->Stop();
+		ReadThread->Shutdown();
 		ReadThread = nullptr;
-
 	}
+	if (FrameIngest)
+	{
+		FrameIngest->Unsubscribe(IngestStream);
+		FrameIngest.Reset();
+	}
+	FrameRing.Reset();
+	bReadFrameRing = false;
+	DetectionStream.Reset();
 	if (Camera.isOpened())
 	{
 		Camera.release();
@@ -106,157 +312,179 @@ void ACVProcessor::EndPlay(const EEndPlayReason::Type EndPlayReason)
 
 void ACVProcessor::ReadFrame()
 {
-	if (Camera.isOpened())
+	UpdateActiveConfig();
+	if (Camera.isOpened() || FrameIngest || bReadFrameRing)
 	{
-		Mat frame;
-		Camera.read(frame);
+		VISION_TIMELINE_SCOPE("Frame");
+		double CaptureTime = 0.0;
+		if (!ReadSourceFrame(CaptureTime)) return;
+		Mat& frame = SourceFrame.Image;
+		VISION_TRACE(FrameCaptured, static_cast<int32>(FrameSequence));
 		if (frame.empty())
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Frame is Empty !!!"));
+			UE_LOG(LogVision, Warning, TEXT("Frame is Empty !!!"));
 			return;
 		}
+		++CaptureWindowFrames;
+		if (CaptureTime - CaptureWindowStart >= 1.0)
+		{
+			if (CaptureWindowStart > 0.0)
+			{
+				CaptureHz.store(static_cast<float>(CaptureWindowFrames / (CaptureTime - CaptureWindowStart)), std::memory_order_relaxed);
+			}
+			CaptureWindowStart = CaptureTime;
+			CaptureWindowFrames = 0;
+		}
 		if (frame.channels() == 4)
 		{
+			VISION_SCOPED_STAGE(Convert);
 			cvtColor(frame, frame, COLOR_BGRA2BGR);
 		}
 		
 		
-		if (DoEnhanceImage)
+		if (ActiveConfig.DoEnhanceImage)
 		{
 			// TODO: EnhanceImage
 		}
 		
-		AsyncTask(ENamedThreads::GameThread, [=]()
+		SendPreview(frame, CaptureTime);
+
+		// All due models share the converted frame, in priority order
+		const double FrameStart = FPlatformTime::Seconds();
+		Scheduler.SetEnabled(EVisionModel::Yolov5Head, ActiveConfig.UseYolov5);
+		Scheduler.SetEnabled(EVisionModel::Yolov3Body, ActiveConfig.UseYolov3);
+		Scheduler.SetEnabled(EVisionModel::SSDResFace, ActiveConfig.UseSSDRes);
+		Profiler.SetEnabled(ActiveConfig.ProfileNetworks);
+		EVisionModel DueModels[FModelScheduler::NumModels];
+		const int32 NumDue = Scheduler.BeginFrame(FrameStart, DueModels);
+		int32 NumRun = 0;
+		bool bYolov5Ran = false;
+		for (int32 i = 0; i < NumDue; ++i)
 		{
-			UTexture2D* OutTexture = ConvertMat2Texture2D(frame);
-			// Show Native Capture Image
-			ShowNativeImage(OutTexture);
-		});
+			const double RunStart = FPlatformTime::Seconds();
+			if (!Scheduler.TryRun(DueModels[i], FrameStart, RunStart, i == 0)) continue;
+			const bool bRan = RunModel(DueModels[i], frame);
+			const double RunEnd = FPlatformTime::Seconds();
+			Scheduler.EndRun(DueModels[i], RunStart, RunEnd);
+			VISION_TRACE(ModelRun, static_cast<int32>(DueModels[i]), static_cast<float>((RunEnd - RunStart) * 1000.0));
+			if (!bRan) continue;
+			bYolov5Ran |= DueModels[i] == EVisionModel::Yolov5Head;
+			++NumRun;
+		}
 
-		if (UseYolov5)
+		// Tracks coast through frames without inference, so they are published on every frame
+		if (ActiveConfig.TrackYolov5)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Use Yolov5 Model"));
-			Yolov5Count = 0;
-			DetectYolov5Head(frame);
+			VISION_SCOPED_STAGE(Tracker);
+			if (bYolov5Ran)
+			{
+				Tracker.Update(Yolov5Candidates, CaptureTime);
+				VISION_TRACE(TrackerUpdate, Tracker.NumTracks(), Tracker.GetLastCostUs());
+			}
+			else
+			{
+				Tracker.Expire(CaptureTime);
+			}
+			Tracker.WriteTracks(CaptureTime, Yolov5Tracks);
+		}
+		if (NumRun > 0 || ActiveConfig.TrackYolov5)
+		{
+			PublishResults(CaptureTime);
 		}
-		// if (UseYolov3)
-		// {
-		// 	UE_LOG(LogTemp, Warning, TEXT("Use Yolov3 Model"));
-		// 	Yolov3Count = 0;
-		// 	DetectYolov3Body(frame);
-		// }
-		// if (UseSSDRes)
-		// {
-		// 	UE_LOG(LogTemp, Warning, TEXT("Use ResNet SSD Model"));
-		// 	SSDResCount = 0;
-		// 	DetectSSDResFace(frame);
-		// }
 	}
 }
 
+bool ACVProcessor::RunModel(EVisionModel Model, Mat& Frame)
+{
+	// OpenCV reports a model that does not take its input by exception, the frame is dropped for that model only
+	try
+	{
+		switch (Model)
+		{
+		case EVisionModel::Yolov5Head:
+		{
+			VISION_SCOPED_STAGE(Yolov5);
+			DetectYolov5Head(Frame);
+			break;
+		}
+		case EVisionModel::Yolov3Body:
+		{
+			VISION_SCOPED_STAGE(Yolov3);
+			DetectYolov3Body(Frame);
+			break;
+		}
+		case EVisionModel::SSDResFace:
+		{
+			VISION_SCOPED_STAGE(SSDRes);
+			DetectSSDResFace(Frame);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	catch (const cv::Exception& Error)
+	{
+		FDetectionBuffer& Result = Model == EVisionModel::Yolov5Head ? Yolov5Result : Model == EVisionModel::Yolov3Body ? Yolov3Result : SSDResResult;
+		Result.Reset();
+		if (Model == EVisionModel::Yolov5Head)
+		{
+			Yolov5Candidates.Reset();
+		}
+		// The same error every frame would flood the log
+		int32& Failures = ModelFailures[static_cast<int32>(Model)];
+		if (Failures++ % 300 == 0)
+		{
+			UE_LOG(LogVision, Error, TEXT("%s Failed On Frame %llu, Frame Dropped (%d Failures): %s"), FModelScheduler::GetModelName(Model), FrameSequence, Failures, UTF8_TO_TCHAR(Error.what()));
+		}
+		return false;
+	}
+	return true;
+}
+
 void ACVProcessor::DetectYolov5Head(Mat& Frame)
 {
 	// Detect With Yolov5 Model
 	if (Frame.empty()) return;
-	Yolov5Count = 0;
+	Yolov5Result.Reset();
+	// The tracker also wants the low score boxes, those are decoded too but only reach Yolov5Candidates
+	Yolov5ScoreFloor = ActiveConfig.TrackYolov5 ? FMath::Min(ActiveConfig.ConfigThreshold, ActiveConfig.TrackLowThreshold) : ActiveConfig.ConfigThreshold;
 	int Width = Frame.cols;
 	int Height = Frame.rows;
-	if (DoResizeImage)
+	if (ActiveConfig.DoResizeImage)
 	{
-		
-		Mat Resized = ResizeImage(Frame, &NewWidth, &NewHeight, &PaddingHeight, &PaddingWidth);
-		
-		Mat Yolov5Bolb = blobFromImage(Resized, 1 / 255.0, Size(Yolov5Width, Yolov5Height), Scalar(0, 0, 0), true, false);
-
-		Yolov5Net.setInput(Yolov5Bolb);
-		UE_LOG(LogTemp, Warning, TEXT("Yolov5Outs Size %llu"), Yolov5Outs.size());
-		for (size_t i = 0; i < Yolov5Outs.size(); ++i)
+		Mat Resized;
 		{
-			Mat output = Yolov5Outs[i];
-			UE_LOG(LogTemp, Warning, TEXT("Data Size %d"), *output.size);
-			UE_LOG(LogTemp, Warning, TEXT("Data Addr %p"), output.data);
+			VISION_SCOPED_STAGE(Resize);
+			Resized = ResizeImage(Frame, ActiveConfig, &NewWidth, &NewHeight, &PaddingHeight, &PaddingWidth);
 		}
-		
-		Yolov5Net.forward(Yolov5Outs, GetOutputsNames(Yolov5Net));
-
-		const int NumProposal = Yolov5Outs[0].size[1];
-		// UE_LOG(LogTemp, Warning, TEXT("NumProposal: %d"), NumProposal);
-		int OutLength = Yolov5Outs[0].size[2];
-		if (Yolov5Outs[0].dims > 2)
+		Mat Yolov5Bolb;
 		{
-			Yolov5Outs[0] = Yolov5Outs[0].reshape(0, NumProposal);
+			VISION_SCOPED_STAGE(Yolov5Blob);
+			Yolov5Bolb = blobFromImage(Resized, 1 / 255.0, Size(ActiveConfig.Yolov5Width, ActiveConfig.Yolov5Height), Scalar(0, 0, 0), true, false);
 		}
-		float RatioWidth = static_cast<float>(Width) / NewWidth;
-		float RatioHeight = static_cast<float>(Height) / NewHeight;
-		// int xMin = 0, yMin = 0, xMax = 0, yMax = 0, Index = 0; 
-		int RowIndex = 0;
-		float* Prediction = (float*)Yolov5Outs[0].data;
-
-		DetectionResult RawResult;
-
-		for (int lS = 0; lS < Yolov5StrideNum; lS++)   ///����ͼ�߶�
 		{
-			const float Stride = pow(2, lS + 3);
-			int GridXNum = static_cast<int>(ceil(Yolov5Width / Stride));
-			int GridYNum = static_cast<int>(ceil(Yolov5Height / Stride));
-			for (int lA = 0; lA < 3; lA++)    ///anchor
-			{
-				const float AnchorWidth = this->Anchors[lS * 6 + lA * 2];
-				const float AnchorHeight = this->Anchors[lS * 6 + lA * 2 + 1];
-				for (int lY = 0; lY < GridYNum; lY++)
-				{
-					for (int lX = 0; lX < GridXNum; lX++)
-					{
-						float BoxScore = Prediction[4];
-						if (BoxScore > ObjectThreshold)
-						{
-							/* For specific case of head detection, class number is only 1, so col5 is used */
-							// Mat ClassScores = Yolov5Outs[0].row(RowIndex).colRange(5, nout);
-							// Point classIdPoint
-							// Get the value and location of the maximum score
-							// minMaxLoc(ClassScores, 0, &MaxClassScore, 0, &classIdPoint);
-							double ClassScore = Prediction[5];
-							ClassScore *= BoxScore;
-							if (ClassScore > ConfigThreshold)
-							{ 
-								// const int class_idx = classIdPoint.x;
-								float centerX = (Prediction[0] * 2.f - 0.5f + lX) * Stride;  ///cx
-								float centerY = (Prediction[1] * 2.f - 0.5f + lY) * Stride;   ///cy
-								float boxWidth = powf(Prediction[2] * 2.f, 2.f) * AnchorWidth;   ///w
-								float boxHeight = powf(Prediction[3] * 2.f, 2.f) * AnchorHeight;  ///h
-
-								int leftBound = static_cast<int>((centerX - PaddingWidth - 0.5 * boxWidth) * RatioWidth);
-								int topBound = static_cast<int>((centerY - PaddingHeight - 0.5 * boxHeight) * RatioHeight);
-
-								RawResult.confidences.push_back(static_cast<float>(ClassScore));
-								RawResult.boxes.push_back(cv::Rect(leftBound, topBound, static_cast<int>(boxWidth * RatioWidth), static_cast<int>(boxHeight * RatioHeight)));
-								RawResult.classID.push_back(0);
-								RawResult.center.push_back({ centerX, centerY });
-								RawResult.size.push_back({ boxWidth, boxHeight });
-							}
-						}
-						RowIndex++;
-						Prediction += OutLength;
-					}
-				}
-			}
+			VISION_SCOPED_STAGE(Yolov5Forward);
+			Yolov5Net.setInput(Yolov5Bolb);
+			Yolov5Net.forward(Yolov5Outs, Yolov5OutNames);
 		}
+		Profiler.Sample(Yolov5Profile, Yolov5Net);
 
-		vector<int> indices;
-		NMSBoxes(RawResult.boxes, RawResult.confidences, ConfigThreshold, NMSThreshold, indices);
-		for (size_t i = 0; i < indices.size(); ++i)
+		const EYoloOutputFormat Format = ResolveYolov5Format(Yolov5Outs);
+		if (Format == EYoloOutputFormat::Auto) return;
+		if (Format == EYoloOutputFormat::Detections)
 		{
-			int index = indices[i];
-			cv::Rect box = RawResult.boxes[index];
-			Yolov5Result.boxes.push_back(box);
-			Yolov5Result.confidences.push_back(RawResult.confidences[index]);
-			Yolov5Result.classID.push_back(0);
-			Yolov5Result.center.push_back(RawResult.center[index]);
-			Yolov5Result.size.push_back(RawResult.size[index]);
-			Yolov5Count++;
-			UE_LOG(LogTemp, Warning, TEXT("Detected At X %d, Y %d, W %d, H %d."), box.x, box.y, box.width, box.height);
+			RawDetections.Reset();
+			DecodeDetections(Yolov5Outs[0], static_cast<float>(Width) / NewWidth, static_cast<float>(Height) / NewHeight, PaddingWidth, PaddingHeight,
+				Yolov5ScoreFloor, RawDetections);
+			KeepYolov5Results();
+			return;
 		}
-		UE_LOG(LogTemp, Warning, TEXT("Detected %d Head(s)."), Yolov5Count);
+
+		RawDetections.Reset();
+		DecodeRawHead(Yolov5Outs[0], static_cast<float>(Width) / NewWidth, static_cast<float>(Height) / NewHeight, RawDetections);
+
+		KeepYolov5Results();
 
 		// delete Prediction;
 		//
@@ -264,10 +492,21 @@ void ACVProcessor::DetectYolov5Head(Mat& Frame)
 	}
 	else
 	{
-		Mat Yolov5Bolb = blobFromImage(Frame, 1 / 255.0, Size(Yolov5Width, Yolov5Height), Scalar(0, 0, 0), true, false);
-		Yolov5Net.setInput(Yolov5Bolb);
-		Yolov5Net.forward(Yolov5Outs, Yolov5Net.getUnconnectedOutLayersNames());
-		PostProcessing(Yolov5Outs, Width, Height, Yolov5Width, Yolov5Height);
+		// The frame is stretched to the input, nothing is padded
+		PaddingWidth = 0;
+		PaddingHeight = 0;
+		Mat Yolov5Bolb;
+		{
+			VISION_SCOPED_STAGE(Yolov5Blob);
+			Yolov5Bolb = blobFromImage(Frame, 1 / 255.0, Size(ActiveConfig.Yolov5Width, ActiveConfig.Yolov5Height), Scalar(0, 0, 0), true, false);
+		}
+		{
+			VISION_SCOPED_STAGE(Yolov5Forward);
+			Yolov5Net.setInput(Yolov5Bolb);
+			Yolov5Net.forward(Yolov5Outs, Yolov5Net.getUnconnectedOutLayersNames());
+		}
+		Profiler.Sample(Yolov5Profile, Yolov5Net);
+		PostProcessing(Yolov5Outs, Width, Height, ActiveConfig.Yolov5Width, ActiveConfig.Yolov5Height);
 	}
 	
 }
@@ -276,43 +515,102 @@ void ACVProcessor::DetectYolov5Head(Mat& Frame)
 void ACVProcessor::DetectYolov3Body(Mat& Frame)
 {
 	if (Frame.empty()) return;
-	Yolov3Count = 0;
 	int Width = Frame.cols;
 	int Height = Frame.rows;
-	Mat Yolov3Bolb = blobFromImage(Frame, 1 / 255.0, Size(Yolov3Width, Yolov3Height), Scalar(0, 0, 0),false, false);
-	Yolov3Net.setInput(Yolov3Bolb);
-	// TODO: Get Yolov3 Output
-	// Yolov3Net.forward(m_outs, getOutputsNames(Yolov3Net));
-	// postprocess(Frame, m_outs);
-	if(!Yolov3Bolb.empty()) Yolov3Bolb.resize(0);
+	// Darknet weights are trained on RGB
+	Mat Yolov3Bolb;
+	{
+		VISION_SCOPED_STAGE(Yolov3Blob);
+		Yolov3Bolb = blobFromImage(Frame, 1 / 255.0, Size(ActiveConfig.Yolov3Width, ActiveConfig.Yolov3Height), Scalar(0, 0, 0), true, false);
+	}
+	{
+		VISION_SCOPED_STAGE(Yolov3Forward);
+		Yolov3Net.setInput(Yolov3Bolb);
+		Yolov3Net.forward(Yolov3Outs, Yolov3OutNames);
+	}
+	Profiler.Sample(Yolov3Profile, Yolov3Net);
+
+	RawDetections.Reset();
+	{
+		VISION_SCOPED_STAGE(Yolov3Decode);
+		const int PersonColumn = 5 + Yolov3PersonClass;
+		for (size_t i = 0; i < Yolov3Outs.size(); ++i)
+		{
+			// Each region output is [proposals, 5 + classes] with normalized centre boxes
+			const Mat& Output = Yolov3Outs[i];
+			const int OutLength = Output.cols;
+			if (PersonColumn >= OutLength) continue;
+			const float* Prediction = (float*)Output.data;
+			for (int lR = 0; lR < Output.rows; ++lR, Prediction += OutLength)
+			{
+				// Objectness first, the region layer has already scaled class scores by it
+				if (Prediction[4] <= ActiveConfig.ObjectThreshold) continue;
+				const float ClassScore = Prediction[PersonColumn];
+				if (ClassScore <= ActiveConfig.ConfigThreshold) continue;
+
+				float centerX = Prediction[0] * Width;
+				float centerY = Prediction[1] * Height;
+				float boxWidth = Prediction[2] * Width;
+				float boxHeight = Prediction[3] * Height;
+
+				RawDetections.Add(centerX - 0.5f * boxWidth, centerY - 0.5f * boxHeight, boxWidth, boxHeight, centerX, centerY, ClassScore, Yolov3PersonClass);
+			}
+		}
+	}
+
+	Yolov3Result.Reset();
+	{
+		VISION_SCOPED_STAGE(Yolov3NMS);
+		KeepNMSResults(RawDetections, Yolov3Result, ActiveConfig.ConfigThreshold);
+	}
+	VISION_TRACE(Bodies, Yolov3Result.Count);
+	UE_LOG(LogVision, Verbose, TEXT("Detected %d Body(s)."), Yolov3Result.Count);
 }
 
 // Detect With ResNet SSD Model
 void ACVProcessor::DetectSSDResFace(Mat& Frame)
 {
 	if (Frame.empty()) return;
-	TArray<UTexture2D*> SSDResOuts;//类似std::Vector动态数组
-	SSDResCount = 0;
-	SSDResFaceX = VACUNT;
-	SSDResFaceY = VACUNT;
-	SSDResFaceSize = VACUNT;
+	SSDResResult.Reset();
 	int Width = Frame.cols;
 	int Height = Frame.rows;
-	Mat SSDResBlob = blobFromImage(Frame, 0.5, Size(SSDResWidth, SSDResHeight), Scalar(0, 0, 0), false, false);
-	SSDResNet.setInput(SSDResBlob, "data");
-	Mat FaceDetection = SSDResNet.forward("detection_out");
-	Mat Detections(FaceDetection.size[2], FaceDetection.size[3], CV_32F, FaceDetection.ptr<float>());
-	
+	Mat SSDResBlob;
+	{
+		VISION_SCOPED_STAGE(SSDResBlob);
+		SSDResBlob = blobFromImage(Frame, 0.5, Size(ActiveConfig.SSDResWidth, ActiveConfig.SSDResHeight), Scalar(0, 0, 0), false, false);
+	}
+	Mat FaceDetection;
+	{
+		VISION_SCOPED_STAGE(SSDResForward);
+		SSDResNet.setInput(SSDResBlob, "data");
+		FaceDetection = SSDResNet.forward("detection_out");
+	}
+	Profiler.Sample(SSDResProfile, SSDResNet);
+	{
+		VISION_SCOPED_STAGE(SSDResDecode);
+		DecodeSSDResFaces(FaceDetection, Width, Height, ActiveConfig.SSDResConfidence, SSDResResult);
+	}
+	// Traced here rather than in DecodeSSDResFaces, so CV.Bench.Suite times the decode without them
+	for (int32 i = 0; i < SSDResResult.Count; ++i)
+	{
+		const float w = SSDResResult.Width[i] / Width;
+		const float h = SSDResResult.Height[i] / Height;
+		VISION_TRACE(Face, i, SSDResResult.CenterX[i], SSDResResult.CenterY[i], FMath::Sqrt(w * w + h * h), SSDResResult.Score[i]);
+	}
+	VISION_TRACE(Faces, SSDResResult.Count);
+	UE_LOG(LogVision, Verbose, TEXT("Detected %d Face(s)."), SSDResResult.Count);
+}
 
-	UE_LOG(LogTemp, Warning, TEXT("####Detected: %d"), Detections.rows);
+void ACVProcessor::DecodeSSDResFaces(const Mat& Output, int Width, int Height, float Confidence, FDetectionBuffer& Result)
+{
+	// Rows of [image, label, confidence, x1, y1, x2, y2] with corners relative to the frame
+	Mat Detections(Output.size[2], Output.size[3], CV_32F, const_cast<float*>(Output.ptr<float>()));
 
 	for (int i = 0; i < Detections.rows; i++)
 	{
-		const float Confidence = Detections.at<float>(i, 2);
-		if(Confidence > SSDResConfidence)
+		const float Score = Detections.at<float>(i, 2);
+		if(Score > Confidence)
 		{
-			++SSDResCount;
-
 			float xTL = Detections.at<float>(i, 3);
 			float yTL = Detections.at<float>(i, 4);
 			float xBR = Detections.at<float>(i, 5);
@@ -321,36 +619,285 @@ void ACVProcessor::DetectSSDResFace(Mat& Frame)
 			float w = xBR - xTL;
 			float h = yBR - yTL;
 
-			float centerX = (xTL + w / 2) * 1920;
-			float centerY = (yTL + h / 2) * 1080;
-			SSDResFaceX.Add(centerX);
-			SSDResFaceY.Add(centerY);
+			float centerX = (xTL + w / 2) * Width;
+			float centerY = (yTL + h / 2) * Height;
+			if (!Result.Add(xTL * Width, yTL * Height, w * Width, h * Height, centerX, centerY, Score, 0)) break;
+		}
+	}
+}
+
+// Fill the detection records from the tracks, moved from their capture time to now, or from the plain Yolov5 result
+void ACVProcessor::BuildDetections(const FDetectionSnapshot& Snapshot, double Now)
+{
+	const FDetectionBuffer& Source = Snapshot.bTracked ? Snapshot.Yolov5Tracks : Snapshot.Yolov5;
+	// Inference lags the game by the capture age, so the tracks are moved forward to now
+	const float Lead = Snapshot.bTracked && PipelineConfig.PredictTracks
+		? FMath::Clamp(static_cast<float>(Now - Snapshot.CaptureTime), 0.f, PipelineConfig.PredictionHorizonMs * 0.001f) : 0.f;
+	const float Timestamp = GetWorld()->GetTimeSeconds() - static_cast<float>(Now - Snapshot.CaptureTime) + Lead;
 
-			float size = sqrt(w * w + h * h);
-			SSDResFaceSize.Add(size);
+	Detections.SetNum(Source.Count, false);
+	for (int32 i = 0; i < Source.Count; ++i)
+	{
+		FVisionDetection& Record = Detections[i];
+		const FVector2D Offset(Source.VelocityX[i] * Lead, Source.VelocityY[i] * Lead);
+		Record.ID = Source.TrackID[i];
+		Record.Position = FVector2D(Source.X[i], Source.Y[i]) + Offset;
+		Record.Size = FVector2D(Source.Width[i], Source.Height[i]);
+		Record.Center = Record.Position + 0.5f * Record.Size;
+		Record.Score = Source.Score[i];
+		Record.ClassID = Source.ClassID[i];
+		Record.Sequence = static_cast<int64>(Snapshot.Sequence);
+		Record.Timestamp = Timestamp;
+	}
+}
 
-			UE_LOG(LogTemp, Warning, TEXT("####Face At X:%f, Y:%f, S:%f"), centerX, centerY, size);
+// Tracks are compared by ID, plain detections by position in the list
+bool ACVProcessor::HaveDetectionsChanged() const
+{
+	if (Detections.Num() != DispatchedDetections.Num()) return true;
+	for (int32 i = 0; i < Detections.Num(); ++i)
+	{
+		const FVisionDetection& Record = Detections[i];
+		const FVisionDetection* Previous = &DispatchedDetections[i];
+		if (Record.ID != INDEX_NONE && Previous->ID != Record.ID)
+		{
+			Previous = DispatchedDetections.FindByPredicate([&Record](const FVisionDetection& Other) { return Other.ID == Record.ID; });
+			if (!Previous) return true;
+		}
+		if (Record.ClassID != Previous->ClassID
+			|| FMath::Abs(Record.Score - Previous->Score) > DetectionScoreHysteresis
+			|| !Record.Center.Equals(Previous->Center, DetectionHysteresisPx)
+			|| !Record.Size.Equals(Previous->Size, DetectionHysteresisPx))
+		{
+			return true;
 		}
 	}
+	return false;
 }
 
-// Convert captured image from OpenCV Mat to Texture2D for Unreal
-UTexture2D* ACVProcessor::ConvertMat2Texture2D(const Mat& InMat)
+// Send a throttled, downscaled copy of the frame to the preview consumers, nothing is done while there are none
+void ACVProcessor::SendPreview(const Mat& Frame, double CaptureTime)
 {
-	int32 Width = InMat.cols;
-	int32 Height = InMat.rows;
-	int32 Channels = InMat.channels();
-	Mat OutMat;
-	cvtColor(InMat, OutMat, CV_RGB2RGBA);
-	UTexture2D* OutTexture = UTexture2D::CreateTransient(Width, Height);
-	OutTexture->SRGB = 0;
-	//NewTexture >CompressionSettings = TextureCompressionSettings::TC_Displacementmap;
-	const int DataSize = Width * Height * 4;
-	void* TextureData = OutTexture->PlatformData->Mips[0].BulkData.Lock(LOCK_READ_WRITE);
-	FMemory::Memmove(TextureData, OutMat.data, DataSize);
-	OutTexture->PlatformData->Mips[0].BulkData.Unlock();
-	OutTexture->UpdateResource();
-	return OutTexture;
+	if (!bPreviewWanted.load(std::memory_order_relaxed)) return;
+	if (ActiveConfig.PreviewTargetHz > 0.f)
+	{
+		// Half a camera frame of slack, so a 15 Hz preview of a 30 Hz camera does not slip to every third frame
+		const double Slack = 0.016;
+		if (CaptureTime < NextPreviewTime - Slack) return;
+		NextPreviewTime = FMath::Max(NextPreviewTime, CaptureTime - Slack) + 1.0 / ActiveConfig.PreviewTargetHz;
+	}
+	VISION_SCOPED_STAGE(Preview);
+
+	const Mat* Source = &Frame;
+	const int PreviewWidth = ActiveConfig.PreviewWidth;
+	if (PreviewWidth > 0 && PreviewWidth < Frame.cols)
+	{
+		const int PreviewHeight = FMath::Max(1, Frame.rows * PreviewWidth / Frame.cols);
+		resize(Frame, PreviewFrame, Size(PreviewWidth, PreviewHeight), 0, 0, INTER_LINEAR);
+		Source = &PreviewFrame;
+	}
+
+	// The task can run after the actor is gone, it only touches the texture through a live actor
+	const TWeakObjectPtr<ACVProcessor> WeakThis(this);
+	if (ActiveConfig.LegacyPreviewUpload)
+	{
+		VISION_TIMELINE_FLOW_START("Preview", FrameSequence);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Image = Source->clone(), Sequence = FrameSequence]()
+		{
+			ACVProcessor* Processor = WeakThis.Get();
+			if (!Processor) return;
+			VISION_SCOPED_STAGE(Submit);
+			VISION_TIMELINE_FLOW_END("Preview", Sequence);
+			Processor->CameraTexture = Processor->NativeTexture.SubmitTransient(Image.ptr(), static_cast<int32>(Image.step), Image.cols, Image.rows);
+			Processor->ShowNativeImage(Processor->CameraTexture);
+			Processor->OnPreviewFrame.Broadcast(Processor->CameraTexture);
+		});
+		return;
+	}
+
+	// The frame is swizzled here straight into a staging buffer, the game thread only queues the texture update
+	const int32 Slot = NativeTexture.AcquireStaging(Source->cols, Source->rows);
+	if (Slot == INDEX_NONE) return;
+	SwizzleBGRToBGRA(Source->ptr(), static_cast<int32>(Source->step), NativeTexture.GetStagingData(Slot), NativeTexture.GetStagingPitch(Slot), Source->cols, Source->rows);
+	VISION_TRACE(PreviewSent, Slot, static_cast<float>(Source->cols), static_cast<float>(Source->rows));
+	// Time spent queued for the game thread shows as the arrow between the two slices
+	VISION_TIMELINE_FLOW_START("Preview", FrameSequence);
+	AsyncTask(ENamedThreads::GameThread, [WeakThis, Slot, Sequence = FrameSequence]()
+	{
+		ACVProcessor* Processor = WeakThis.Get();
+		if (!Processor) return;
+		VISION_SCOPED_STAGE(Submit);
+		VISION_TIMELINE_FLOW_END("Preview", Sequence);
+		// Show Native Capture Image
+		UTexture2D* Texture = Processor->NativeTexture.Submit(Slot, Processor->CameraTexture);
+		Processor->ShowNativeImage(Texture);
+		Processor->OnPreviewFrame.Broadcast(Texture);
+	});
+}
+
+// Copy the latest result of every model into a snapshot and hand it to the game thread
+void ACVProcessor::PublishResults(double CaptureTime)
+{
+	VISION_SCOPED_STAGE(Publish);
+	FDetectionSnapshot& Snapshot = Results.GetWriteBuffer();
+	Snapshot.Sequence = FrameSequence;
+	Snapshot.CaptureTime = CaptureTime;
+	Snapshot.SourceTimestampUs = SourceTimestampUs;
+	Snapshot.bTracked = ActiveConfig.TrackYolov5;
+	Snapshot.PublishTime = FPlatformTime::Seconds();
+	Snapshot.Yolov5.CopyFrom(Yolov5Result);
+	Snapshot.Yolov3.CopyFrom(Yolov3Result);
+	Snapshot.SSDRes.CopyFrom(SSDResResult);
+	Snapshot.Yolov5Tracks.CopyFrom(Yolov5Tracks);
+	// Encoded before the snapshot goes to the game thread, which may read it from then on
+	if (DetectionStream)
+	{
+		DetectionStream->Publish(Snapshot, SourceFrame.Image.cols, SourceFrame.Image.rows);
+	}
+	Results.Publish();
+	VISION_TIMELINE_FLOW_START("Result", FrameSequence);
+	VISION_TRACE(Published, static_cast<int32>(FrameSequence));
+}
+
+// Apply the per model rate, priority and deadline of the active config to the scheduler
+void ACVProcessor::ConfigureScheduler()
+{
+	FModelSchedule Yolov5Schedule;
+	Yolov5Schedule.TargetHz = ActiveConfig.Yolov5TargetHz;
+	Yolov5Schedule.Priority = ActiveConfig.Yolov5Priority;
+	Yolov5Schedule.DeadlineMs = ActiveConfig.Yolov5DeadlineMs;
+	Yolov5Schedule.bEnabled = ActiveConfig.UseYolov5;
+	Scheduler.Configure(EVisionModel::Yolov5Head, Yolov5Schedule);
+
+	FModelSchedule Yolov3Schedule;
+	Yolov3Schedule.TargetHz = ActiveConfig.Yolov3TargetHz;
+	Yolov3Schedule.Priority = ActiveConfig.Yolov3Priority;
+	Yolov3Schedule.DeadlineMs = ActiveConfig.Yolov3DeadlineMs;
+	Yolov3Schedule.bEnabled = ActiveConfig.UseYolov3;
+	Scheduler.Configure(EVisionModel::Yolov3Body, Yolov3Schedule);
+
+	FModelSchedule SSDResSchedule;
+	SSDResSchedule.TargetHz = ActiveConfig.SSDResTargetHz;
+	SSDResSchedule.Priority = ActiveConfig.SSDResPriority;
+	SSDResSchedule.DeadlineMs = ActiveConfig.SSDResDeadlineMs;
+	SSDResSchedule.bEnabled = ActiveConfig.UseSSDRes;
+	Scheduler.Configure(EVisionModel::SSDResFace, SSDResSchedule);
+
+	Scheduler.SetFrameBudget(ActiveConfig.FrameBudgetMs);
+
+	Profiler.SetWindow(ActiveConfig.ProfileWindow);
+	Profiler.SetTopN(ActiveConfig.ProfileTopN);
+}
+
+// Tracker thresholds of the active config, the tracks start over
+void ACVProcessor::ConfigureTracker()
+{
+	FTrackerConfig TrackerConfig;
+	TrackerConfig.HighThreshold = ActiveConfig.TrackHighThreshold;
+	TrackerConfig.LowThreshold = ActiveConfig.TrackLowThreshold;
+	TrackerConfig.NewTrackThreshold = FMath::Max(ActiveConfig.TrackHighThreshold, TrackerConfig.NewTrackThreshold);
+	TrackerConfig.MinHits = ActiveConfig.TrackMinHits;
+	TrackerConfig.MaxCoastSeconds = ActiveConfig.TrackMaxCoastSeconds;
+	TrackerConfig.MaxTracks = MaxDetections;
+	TrackerConfig.PredictionHorizon = ActiveConfig.PredictionHorizonMs * 0.001f;
+	Tracker.Configure(TrackerConfig);
+}
+
+void ACVProcessor::ApplyPipelineConfig(const FVisionPipelineConfig& NewConfig)
+{
+	PipelineConfig = NewConfig;
+	PipelineConfig.Validate();
+	AppliedConfig = PipelineConfig;
+	{
+		FScopeLock Lock(&PendingConfigLock);
+		PendingConfig = PipelineConfig;
+	}
+	bConfigPending.store(true, std::memory_order_release);
+}
+
+bool ACVProcessor::ReloadPipelineConfig()
+{
+	FVisionPipelineConfig Loaded = PipelineConfig;
+	const FString ConfigPath = GetPipelineConfigPath();
+	PipelineConfigTime = IFileManager::Get().GetTimeStamp(*ConfigPath);
+	if (!Loaded.LoadFromFile(ConfigPath)) return false;
+	UE_LOG(LogVision, Log, TEXT("Pipeline Config Reloaded: %s"), *ConfigPath);
+	ApplyPipelineConfig(Loaded);
+	return true;
+}
+
+bool ACVProcessor::SavePipelineConfig() const
+{
+	return PipelineConfig.SaveToFile(GetPipelineConfigPath());
+}
+
+FString ACVProcessor::GetPipelineConfigPath() const
+{
+	return FPaths::IsRelative(PipelineConfigFile) ? FPaths::ProjectConfigDir() / PipelineConfigFile : PipelineConfigFile;
+}
+
+// Reload the config file once a second when its time stamp changed
+void ACVProcessor::PollPipelineConfig(double Now)
+{
+	if (!bWatchPipelineConfig || Now < NextConfigPoll) return;
+	NextConfigPoll = Now + 1.0;
+	const FDateTime Time = IFileManager::Get().GetTimeStamp(*GetPipelineConfigPath());
+	if (Time != FDateTime::MinValue() && Time != PipelineConfigTime)
+	{
+		ReloadPipelineConfig();
+	}
+}
+
+void ACVProcessor::UpdateActiveConfig()
+{
+	if (!bConfigPending.exchange(false, std::memory_order_acquire)) return;
+	FVisionPipelineConfig Previous = ActiveConfig;
+	{
+		FScopeLock Lock(&PendingConfigLock);
+		ActiveConfig = PendingConfig;
+	}
+	// A static shape model throws at any other input size, so a new size is tried before the frames get it
+	if (ActiveConfig.ChangesYolov5Input(Previous) && !ProbeYolov5Input())
+	{
+		UE_LOG(LogVision, Error, TEXT("Yolov5 Model Does Not Take %d x %d, Keeping %d x %d"), ActiveConfig.Yolov5Width, ActiveConfig.Yolov5Height, Previous.Yolov5Width, Previous.Yolov5Height);
+		ActiveConfig.Yolov5Width = Previous.Yolov5Width;
+		ActiveConfig.Yolov5Height = Previous.Yolov5Height;
+		ActiveConfig.Yolov5StrideNum = Previous.Yolov5StrideNum;
+	}
+	// A new input size changes the number of raw proposals the layout is told apart by
+	if (ActiveConfig.ChangesYolov5Input(Previous) || ActiveConfig.Yolov5OutputFormat != Previous.Yolov5OutputFormat)
+	{
+		ResolvedYolov5Format = EYoloOutputFormat::Auto;
+		bYolov5FormatAmbiguous = false;
+		UE_LOG(LogVision, Log, TEXT("Yolov5 Input Now %d x %d With %d Levels"), ActiveConfig.Yolov5Width, ActiveConfig.Yolov5Height, ActiveConfig.Yolov5StrideNum);
+	}
+	if (ActiveConfig.ChangesSchedule(Previous))
+	{
+		ConfigureScheduler();
+	}
+	if (ActiveConfig.ChangesTracker(Previous))
+	{
+		ConfigureTracker();
+	}
+}
+
+bool ACVProcessor::ProbeYolov5Input()
+{
+	if (Yolov5Net.empty()) return true;
+	const int Shape[] = { 1, 3, ActiveConfig.Yolov5Height, ActiveConfig.Yolov5Width };
+	try
+	{
+		Yolov5Net.setInput(Mat(4, Shape, CV_32F, Scalar(0)));
+		Yolov5Net.forward(Yolov5Outs, Yolov5OutNames);
+	}
+	catch (const cv::Exception& Error)
+	{
+		UE_LOG(LogVision, Warning, TEXT("Yolov5 Probe At %d x %d Failed: %s"), ActiveConfig.Yolov5Width, ActiveConfig.Yolov5Height, UTF8_TO_TCHAR(Error.what()));
+		return false;
+	}
+	// The layers are set up for the new size now, the outputs are looked up again against them
+	Yolov5OutNames = GetOutputsNames(Yolov5Net);
+	return true;
 }
 
 // Initialize Camera and Thread Runnable
@@ -358,9 +905,10 @@ void ACVProcessor::InitCameraAndThreadRunnable(uint32 index)
 {
 	Async<>(EAsyncExecution::Thread, [=]()
 	{
+		VISION_TIMELINE_SCOPE("OpenCamera");
 		if (Camera.open(index))
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Open Camera Sucessful !!!"));
+			UE_LOG(LogVision, Log, TEXT("Open Camera Sucessful !!!"));
 			Camera.set(CV_CAP_PROP_FRAME_WIDTH,1920);
 			Camera.set(CV_CAP_PROP_FRAME_HEIGHT,1080);
 			Camera.set(CV_CAP_PROP_FPS, 30);
@@ -368,34 +916,101 @@ void ACVProcessor::InitCameraAndThreadRunnable(uint32 index)
 		}
 		else
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Open Camera Failed !!!"));
+			UE_LOG(LogVision, Error, TEXT("Open Camera Failed !!!"));
 		}
 		FPlatformProcess::Sleep(0.01);
 	});
 }
 
-Mat ACVProcessor::ResizeImage(Mat InMat, int *Width, int *Height, int *Top, int *Left)
+// Serve frames of IngestStream from the ingest server of IngestPort, shared with other actors on the same port
+void ACVProcessor::StartFrameIngest()
+{
+	if (IngestStream < 0 || IngestStream >= VisionWire::MaxStreams)
+	{
+		UE_LOG(LogVision, Error, TEXT("Frame Ingest Stream %d Is Not Below %d"), IngestStream, VisionWire::MaxStreams);
+		return;
+	}
+	FrameIngest = FFrameIngestServer::Acquire(IngestPort, IngestDecodeThreads);
+	if (!FrameIngest) return;
+	LastIngestStats = FrameIngest->GetStats();
+	FrameIngest->Subscribe(IngestStream);
+	ReadThread = FReadImageRunnable::InitReadRunnable(this);
+}
+
+// Frames are read in place from the ring, the capture process runs on its own
+void ACVProcessor::StartFrameRing()
+{
+	bReadFrameRing = true;
+	ReadThread = FReadImageRunnable::InitReadRunnable(this);
+}
+
+bool ACVProcessor::ReadSourceFrame(double& CaptureTime)
+{
+	VISION_SCOPED_STAGE(Capture);
+	if (bReadFrameRing)
+	{
+		// The producer may start after the game or restart, the ring is opened again until frames flow
+		if (!FrameRing || FrameRing->IsStale())
+		{
+			const double Now = FPlatformTime::Seconds();
+			if (Now < NextFrameRingOpen)
+			{
+				FPlatformProcess::Sleep(0.1f);
+				return false;
+			}
+			NextFrameRingOpen = Now + 1.0;
+			// The old reader gives up its entry before the new one claims one
+			FrameRing.Reset();
+			FrameRing = FFrameRingReader::Open(FrameRingName);
+			if (!FrameRing) return false;
+		}
+		// The image stays a view of the slot until the next frame is acquired
+		if (!FrameRing->Acquire(SourceFrame, 0.1)) return false;
+		FrameSequence = SourceFrame.Sequence;
+		SourceTimestampUs = SourceFrame.TimestampUs;
+		CaptureTime = SourceFrame.ReceiveTime;
+		return true;
+	}
+	if (FrameIngest)
+	{
+		// Sequence and timestamp of the sender travel with the frame to its results
+		if (!FrameIngest->WaitForFrame(IngestStream, SourceFrame, 0.1)) return false;
+		FrameSequence = SourceFrame.Sequence;
+		SourceTimestampUs = SourceFrame.TimestampUs;
+		CaptureTime = SourceFrame.ReceiveTime;
+		return true;
+	}
+	Camera.read(SourceFrame.Image);
+	++FrameSequence;
+	CaptureTime = FPlatformTime::Seconds();
+	SourceTimestampUs = static_cast<uint64>(CaptureTime * 1e6);
+	return true;
+}
+
+Mat ACVProcessor::ResizeImage(const Mat& InMat, const FVisionPipelineConfig& Config, int *Width, int *Height, int *Top, int *Left)
 {
 	const int InWidth = InMat.cols;
 	const int InHeight = InMat.rows;
-	*Width = Yolov5Width;
-	*Height = Yolov5Height;
+	*Top = 0;
+	*Left = 0;
+	*Width = Config.Yolov5Width;
+	*Height = Config.Yolov5Height;
 	Mat OutMat;
-	if (DoKeepRatio && InHeight != InWidth) {
+	if (Config.DoKeepRatio && InHeight != InWidth) {
 		const float InScale = static_cast<float>(InHeight) / InWidth;
 		if (InScale > 1) {
-			*Width = static_cast<int>(Yolov5Width / InScale);
-			*Height = Yolov5Height;
+			*Width = static_cast<int>(Config.Yolov5Width / InScale);
+			*Height = Config.Yolov5Height;
 			resize(InMat, OutMat, Size(*Width, *Height), INTER_AREA);
-			*Left = static_cast<int>((Yolov5Width - *Width) * 0.5);
-			copyMakeBorder(OutMat, OutMat, 0, 0, *Left, Yolov5Width - *Width - *Left, BORDER_CONSTANT, 114);
+			*Left = static_cast<int>((Config.Yolov5Width - *Width) * 0.5);
+			copyMakeBorder(OutMat, OutMat, 0, 0, *Left, Config.Yolov5Width - *Width - *Left, BORDER_CONSTANT, 114);
 		}
 		else {
-			*Width = Yolov5Width;
-			*Height = static_cast<int>(Yolov5Height * InScale);
+			*Width = Config.Yolov5Width;
+			*Height = static_cast<int>(Config.Yolov5Height * InScale);
 			resize(InMat, OutMat, Size(*Width, *Height), INTER_AREA);
-			*Top = static_cast<int>((Yolov5Height - *Height) * 0.5);
-			copyMakeBorder(OutMat, OutMat, *Top, Yolov5Height - *Height - *Top, 0, 0, BORDER_CONSTANT, 114);
+			*Top = static_cast<int>((Config.Yolov5Height - *Height) * 0.5);
+			copyMakeBorder(OutMat, OutMat, *Top, Config.Yolov5Height - *Height - *Top, 0, 0, BORDER_CONSTANT, 114);
 		}
 	}
 	else {
@@ -406,103 +1021,230 @@ Mat ACVProcessor::ResizeImage(Mat InMat, int *Width, int *Height, int *Top, int
 
 void ACVProcessor::PostProcessing(vector<Mat>& Outs, int Width, int Height, int InWidth, int InHeight)
 {
-	const int NumProposal = Outs[0].size[1];
-	int OutLength = Outs[0].size[2];
-	if (Outs[0].dims > 2)
+	const EYoloOutputFormat Format = ResolveYolov5Format(Outs);
+	if (Format == EYoloOutputFormat::Auto) return;
+	if (Format == EYoloOutputFormat::Detections)
 	{
-		Outs[0] = Outs[0].reshape(0, NumProposal);
+		RawDetections.Reset();
+		DecodeDetections(Outs[0], static_cast<float>(Width) / InWidth, static_cast<float>(Height) / InHeight, 0, 0, Yolov5ScoreFloor, RawDetections);
+		KeepYolov5Results();
+		return;
 	}
-	float RatioWidth = static_cast<float>(Width) / InWidth;
-	float RatioHeight = static_cast<float>(Height) / InHeight;
-	// TODO Change Variable Name
-	// int xMin = 0, yMin = 0, xMax = 0, yMax = 0, Index = 0; 
-	int RowIndex = 0;
-	float* Prediction = (float*)Outs[0].data;
 
-	DetectionResult RawResult;
+	RawDetections.Reset();
+	DecodeRawHead(Outs[0], static_cast<float>(Width) / InWidth, static_cast<float>(Height) / InHeight, RawDetections);
+
+	KeepYolov5Results();
+}
+
+// Decode a raw detection head with the decoder specialized for its level and class count
+void ACVProcessor::DecodeRawHead(const Mat& Output, float RatioWidth, float RatioHeight, FDetectionBuffer& RawResult)
+{
+	VISION_SCOPED_STAGE(Yolov5Decode);
+	FYoloDecodeParams Params;
+	const int OutLength = Output.size[Output.dims - 1];
+	Params.Data = (const float*)Output.data;
+	Params.NumRows = static_cast<int32>(Output.total() / OutLength);
+	Params.InputWidth = ActiveConfig.Yolov5Width;
+	Params.InputHeight = ActiveConfig.Yolov5Height;
+	Params.ObjectThreshold = FMath::Min(ActiveConfig.ObjectThreshold, Yolov5ScoreFloor);
+	Params.ConfigThreshold = Yolov5ScoreFloor;
+	Survivors.resize(Params.NumRows);
+	Params.Survivors = Survivors.data();
+
+	// Boxes are mapped from the letterboxed input back to the frame, proposals past the capacity are dropped
+	auto Sink = [&RawResult, RatioWidth, RatioHeight, PadWidth = PaddingWidth, PadHeight = PaddingHeight](float Score, int32 ClassId, float centerX, float centerY, float boxWidth, float boxHeight)
+	{
+		RawResult.Add((centerX - PadWidth - 0.5f * boxWidth) * RatioWidth, (centerY - PadHeight - 0.5f * boxHeight) * RatioHeight,
+			boxWidth * RatioWidth, boxHeight * RatioHeight, centerX, centerY, Score, ClassId);
+	};
 
-	for (int lS = 0; lS < Yolov5StrideNum; lS++)   ///����ͼ�߶�
+	if (ActiveConfig.Yolov5StrideNum == 3 && OutLength == FYoloHead640Decoder::RowLength)
+	{
+		FYoloHead640Decoder::Decode(Params, Anchors640, Sink);
+	}
+	else if (ActiveConfig.Yolov5StrideNum == 3 && OutLength == FYoloCoco640Decoder::RowLength)
+	{
+		FYoloCoco640Decoder::Decode(Params, Anchors640, Sink);
+	}
+	else if (ActiveConfig.Yolov5StrideNum == 4 && OutLength == FYoloHead1280Decoder::RowLength)
+	{
+		FYoloHead1280Decoder::Decode(Params, Anchors1280, Sink);
+	}
+	else if (ActiveConfig.Yolov5StrideNum == 4 && OutLength == FYoloCoco1280Decoder::RowLength)
+	{
+		FYoloCoco1280Decoder::Decode(Params, Anchors1280, Sink);
+	}
+	else if (ActiveConfig.Yolov5StrideNum == 3 && OutLength > 5)
+	{
+		Params.NumClasses = OutLength - 5;
+		FYolo640Decoder::Decode(Params, Anchors640, Sink);
+	}
+	else if (ActiveConfig.Yolov5StrideNum == 4 && OutLength > 5)
+	{
+		Params.NumClasses = OutLength - 5;
+		FYolo1280Decoder::Decode(Params, Anchors1280, Sink);
+	}
+	else
+	{
+		UE_LOG(LogVision, Warning, TEXT("No Yolov5 Decoder For %d Levels With Row Length %d"), ActiveConfig.Yolov5StrideNum, OutLength);
+	}
+}
+
+/*
+ * Pick the decoder from the output shape on the first forward. A raw head has one row per grid cell
+ * and anchor under a batch dimension, the ONNX Runtime end-to-end export a plain [N, 7] matrix.
+ * A [1, N, 6 or 7] output that is not one row per anchor fits both an end-to-end export and a one or
+ * two class head exported at another input size, so that takes Yolov5OutputFormat and nothing is
+ * decoded until it is set. Exports that decode the boxes in the graph but keep one row per anchor
+ * have the raw head's shape and are read as one, they are not supported.
+ * Returns Auto while the format is unresolved.
+ */
+EYoloOutputFormat ACVProcessor::ResolveYolov5Format(const vector<Mat>& Outs)
+{
+	if (ResolvedYolov5Format != EYoloOutputFormat::Auto) return ResolvedYolov5Format;
+	if (ActiveConfig.Yolov5OutputFormat != EYoloOutputFormat::Auto)
 	{
-		const float Stride = pow(2, lS + 3);
-		int GridXNum = static_cast<int>(ceil(Yolov5Width / Stride));
-		int GridYNum = static_cast<int>(ceil(Yolov5Height / Stride));
-		for (int lA = 0; lA < 3; lA++)    ///anchor
+		ResolvedYolov5Format = ActiveConfig.Yolov5OutputFormat;
+		bYolov5FormatAmbiguous = false;
+		return ResolvedYolov5Format;
+	}
+	if (bYolov5FormatAmbiguous) return EYoloOutputFormat::Auto;
+
+	const Mat& Output = Outs[0];
+	const int OutLength = Output.size[Output.dims - 1];
+	const int NumRows = static_cast<int>(Output.total() / OutLength);
+	int RawProposals = 0;
+	for (int lS = 0; lS < ActiveConfig.Yolov5StrideNum; lS++)
+	{
+		const int Stride = 8 << lS;
+		RawProposals += 3 * ((ActiveConfig.Yolov5Width + Stride - 1) / Stride) * ((ActiveConfig.Yolov5Height + Stride - 1) / Stride);
+	}
+	const bool bDetectionColumns = OutLength == 6 || OutLength == 7;
+	if (Outs.size() == 1 && Output.dims == 2 && bDetectionColumns)
+	{
+		ResolvedYolov5Format = EYoloOutputFormat::Detections;
+	}
+	else if (NumRows == RawProposals || !bDetectionColumns)
+	{
+		if (NumRows != RawProposals)
 		{
-			const float AnchorWidth = this->Anchors[lS * 6 + lA * 2];
-			const float AnchorHeight = this->Anchors[lS * 6 + lA * 2 + 1];
-			for (int lY = 0; lY < GridYNum; lY++)
-			{
-				for (int lX = 0; lX < GridXNum; lX++)
-				{
-					float BoxScore = Prediction[4];
-					if (BoxScore > ObjectThreshold)
-					{
-						// TODO: Get & Set Class Score
-						/* For specific case of head detection, class number is only 1, so col5 is used */
-						// Mat ClassScores = Yolov5Outs[0].row(RowIndex).colRange(5, nout);
-						// Point classIdPoint
-						// Get the value and location of the maximum score
-						// minMaxLoc(ClassScores, 0, &MaxClassScore, 0, &classIdPoint);
-						double ClassScore = Prediction[5];
-						ClassScore *= BoxScore;
-						if (ClassScore > ConfigThreshold)
-						{ 
-							// const int class_idx = classIdPoint.x;
-							float centerX = (Prediction[0] * 2.f - 0.5f + lX) * Stride;  ///cx
-							float centerY = (Prediction[1] * 2.f - 0.5f + lY) * Stride;   ///cy
-							float boxWidth = powf(Prediction[2] * 2.f, 2.f) * AnchorWidth;   ///w
-							float boxHeight = powf(Prediction[3] * 2.f, 2.f) * AnchorHeight;  ///h
-
-							int leftBound = static_cast<int>((centerX - PaddingWidth - 0.5 * boxWidth) * RatioWidth);
-							int topBound = static_cast<int>((centerY - PaddingHeight - 0.5 * boxHeight) * RatioHeight);
-
-							RawResult.confidences.push_back(static_cast<float>(ClassScore));
-							RawResult.boxes.push_back(cv::Rect(leftBound, topBound, static_cast<int>(boxWidth * RatioWidth), static_cast<int>(boxHeight * RatioHeight)));
-							Yolov5Result.classID.push_back(0);
-						}
-					}
-					RowIndex++;
-					Prediction += OutLength;
-				}
-			}
+			UE_LOG(LogVision, Warning, TEXT("Yolov5 Output Has %d Rows, %d x %d With %d Levels Expects %d"), NumRows,
+				ActiveConfig.Yolov5Width, ActiveConfig.Yolov5Height, ActiveConfig.Yolov5StrideNum, RawProposals);
 		}
+		ResolvedYolov5Format = EYoloOutputFormat::RawHead;
 	}
-
-	vector<int> indices;
-	NMSBoxes(RawResult.boxes, RawResult.confidences, ConfigThreshold, NMSThreshold, indices);
-	for (size_t i = 0; i < indices.size(); ++i)
+	else
 	{
-		int index = indices[i];
-		cv::Rect box = RawResult.boxes[index];
-		Yolov5Result.boxes.push_back(box);
-		Yolov5Result.confidences.push_back(RawResult.confidences[index]);
-		Yolov5Result.classID.push_back(0);
-		Yolov5Count++;
-		UE_LOG(LogTemp, Warning, TEXT("Detected At X %d, Y %d, W %d, H %d."), box.x, box.y, box.width, box.height);
+		bYolov5FormatAmbiguous = true;
+		UE_LOG(LogVision, Error, TEXT("Yolov5 Output %d x %d Fits Both An End-to-End Export And A Raw Head Of Another Size, Set Yolov5OutputFormat"), NumRows, OutLength);
+		return EYoloOutputFormat::Auto;
 	}
-	UE_LOG(LogTemp, Warning, TEXT("Detected %d Head(s)."), Yolov5Count);
+	UE_LOG(LogVision, Log, TEXT("Yolov5 Output %d x %d, Using %s Decoder"), NumRows, OutLength,
+		ResolvedYolov5Format == EYoloOutputFormat::Detections ? TEXT("End-to-End") : TEXT("Raw Head"));
+	return ResolvedYolov5Format;
 }
 
-vector<String> ACVProcessor::GetOutputsNames(const Net& net)
+// Read an end-to-end detections tensor, boxes are corners in network input pixels
+// The rows still go through KeepNMSResults, which is cheap on so few boxes and covers exports without in-graph NMS
+void ACVProcessor::DecodeDetections(const Mat& Output, float RatioWidth, float RatioHeight, int PadWidth, int PadHeight, float ScoreThreshold, FDetectionBuffer& RawResult)
 {
-	static std::vector<cv::String> names;
-	if (names.empty())
+	VISION_SCOPED_STAGE(Yolov5Decode);
+	const int OutLength = Output.size[Output.dims - 1];
+	const int NumRows = static_cast<int>(Output.total() / OutLength);
+	// [x0, y0, x1, y1, score, class], or [batch, x0, y0, x1, y1, class, score] from ONNX Runtime
+	const bool bBatchColumn = OutLength == 7;
+	const int BoxColumn = bBatchColumn ? 1 : 0;
+	const int ScoreColumn = bBatchColumn ? 6 : 4;
+	const int ClassColumn = 5;
+	const float* Row = (const float*)Output.data;
+	for (int lR = 0; lR < NumRows; ++lR, Row += OutLength)
 	{
-		//Get the indices of the output layers, i.e. the layers with unconnected outputs
-		OutLayers = net.getUnconnectedOutLayers();
+		const float Score = Row[ScoreColumn];
+		if (Score <= ScoreThreshold) continue;
 
-		//get the names of all the layers in the network
-		LayersNames = net.getLayerNames();
+		const float* Box = Row + BoxColumn;
+		const float boxWidth = Box[2] - Box[0];
+		const float boxHeight = Box[3] - Box[1];
+		const float centerX = Box[0] + 0.5f * boxWidth;
+		const float centerY = Box[1] + 0.5f * boxHeight;
 
-		// Get the names of the output layers in names
-		names.resize(OutLayers.size());
-		for (size_t i = 0; i < OutLayers.size(); ++i)
-			names[i] = LayersNames[OutLayers[i] - 1];
+		if (!RawResult.Add((Box[0] - PadWidth) * RatioWidth, (Box[1] - PadHeight) * RatioHeight, boxWidth * RatioWidth, boxHeight * RatioHeight,
+			centerX, centerY, Score, static_cast<int32>(Row[ClassColumn]))) break;
 	}
-	return names;
 }
 
+// Run NMS on the raw proposals and append the kept ones to Result, returns the number kept
+int ACVProcessor::KeepNMSResults(const FDetectionBuffer& RawResult, FDetectionBuffer& Result, float ScoreThreshold)
+{
+	FNMSConfig Config;
+	Config.ScoreThreshold = ScoreThreshold;
+	Config.IoUThreshold = ActiveConfig.NMSThreshold;
+	Config.TopK = ActiveConfig.NMSTopK;
+	Config.bClassAware = ActiveConfig.ClassAwareNMS;
+	Config.SoftMode = static_cast<ESoftNMS>(ActiveConfig.SoftNMSMode);
+	Config.SoftSigma = ActiveConfig.SoftNMSSigma;
+	Config.GridMinCandidates = ActiveConfig.GridNMSMinCandidates;
+	NMS.Run(RawResult.X.GetData(), RawResult.Y.GetData(), RawResult.Width.GetData(), RawResult.Height.GetData(), RawResult.Score.GetData(), RawResult.ClassID.GetData(),
+		RawResult.Count, Config, NMSKept, &NMSScores);
 
-/*Thread Instance*/
-FReadImageRunnable*  FReadImageRunnable::ReadInstance = nullptr;
+	int NumKept = 0;
+	for (int32 i = 0; i < NMSKept.Num(); ++i)
+	{
+		const int32 index = NMSKept[i];
+		if (!Result.AddFrom(RawResult, index, NMSScores[i])) break;
+		++NumKept;
+		VISION_TRACE(Detection, RawResult.ClassID[index], RawResult.X[index], RawResult.Y[index], RawResult.Width[index], RawResult.Height[index]);
+	}
+	return NumKept;
+}
 
+// NMS over everything the tracker can use, Yolov5Result is the part above ConfigThreshold.
+// With greedy NMS and no TopK that is what NMS on those boxes alone keeps, since a lower box never
+// suppresses a higher one. Soft-NMS and TopK can differ once the low boxes take part.
+void ACVProcessor::KeepYolov5Results()
+{
+	Yolov5Candidates.Reset();
+	{
+		VISION_SCOPED_STAGE(Yolov5NMS);
+		KeepNMSResults(RawDetections, Yolov5Candidates, Yolov5ScoreFloor);
+	}
+	for (int32 i = 0; i < Yolov5Candidates.Count; ++i)
+	{
+		if (Yolov5Candidates.Score[i] > ActiveConfig.ConfigThreshold && !Yolov5Result.AddFrom(Yolov5Candidates, i, Yolov5Candidates.Score[i])) break;
+	}
+	VISION_TRACE(Heads, Yolov5Result.Count);
+	UE_LOG(LogVision, Verbose, TEXT("Detected %d Head(s)."), Yolov5Result.Count);
+}
+
+vector<String> ACVProcessor::GetOutputsNames(const Net& net)
+{
+	vector<String> names;
+	//Get the indices of the output layers, i.e. the layers with unconnected outputs
+	const vector<int> OutLayers = net.getUnconnectedOutLayers();
+
+	//get the names of all the layers in the network
+	const vector<String> LayersNames = net.getLayerNames();
+
+	// Get the names of the output layers in names
+	names.resize(OutLayers.size());
+	for (size_t i = 0; i < OutLayers.size(); ++i)
+		names[i] = LayersNames[OutLayers[i] - 1];
+	return names;
+}
+
+vector<string> ACVProcessor::LoadClassNames(const FString& Path)
+{
+	vector<string> Names;
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *Path))
+	{
+		UE_LOG(LogVision, Warning, TEXT("Class Names Did Not Load: %s"), *Path);
+		return Names;
+	}
+	for (const FString& Line : Lines)
+	{
+		Names.push_back(TCHAR_TO_UTF8(*Line.TrimStartAndEnd()));
+	}
+	return Names;
+}
@@ -7,6 +7,21 @@
 
 
 #include "OpenCVLibrary.h"
+#include "ModelScheduler.h"
+#include "DNNProfiler.h"
+#include "YoloDecoder.h"
+#include "NMSEngine.h"
+#include "DetectionBuffer.h"
+#include "ObjectTracker.h"
+#include "TripleBuffer.h"
+#include "PreviewTexture.h"
+#include "VisionDetection.h"
+#include "VisionConfig.h"
+#include "FrameIngest.h"
+#include "FrameRing.h"
+#include "DetectionStream.h"
+#include "VisionLog.h"
+#include "VisionStats.h"
 #include "Runtime/Core/Public/HAL/RunnableThread.h"
 #include "Runtime/Core/Public/HAL/Runnable.h"
 
@@ -18,25 +33,7 @@ using namespace cv;
 using namespace dnn;
 using namespace std;
 
-struct NetConfig
-{
-	float confThreshold; // Confidence threshold
-	float nmsThreshold;  // Non-maximum suppression threshold
-	float objThreshold;  //Object Confidence threshold
-	string modelpath;
-};
-
-struct DetectionResult
-{
-	int count;
-	vector<float> confidences;
-	vector<cv::Rect> boxes;
-	vector<int> classID;
-	vector<vector<float>> center;
-	vector<vector<float>> size;
-};
-
-
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPreviewFrame, UTexture2D*, Texture);
 
 UCLASS()
 class G_COMPILE_API ACVProcessor : public AActor
@@ -54,7 +51,7 @@ public:
 
 	/* Camera */
 	VideoCapture Camera;
-	FReadImageRunnable* ReadThread;
+	FReadImageRunnable* ReadThread = nullptr;
 
 	/* Actor Default */
 	// Called when the game starts or when spawned
@@ -68,7 +65,12 @@ public:
 	void ReadFrame();
 
 	/* Result Struct */
-	DetectionResult Yolov5Result;
+	// Written by the reader thread only, the game thread reads the published snapshots
+	FDetectionBuffer Yolov5Result;
+	FDetectionBuffer Yolov3Result;
+	FDetectionBuffer SSDResResult;
+	FDetectionBuffer Yolov5Tracks;
+	TLockFreeTripleBuffer<FDetectionSnapshot> Results;
 
 	/* Result Var - UPROPERTY */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
@@ -77,6 +79,132 @@ public:
 	int Yolov3Count = 0;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	int SSDResCount = 0;
+	// Frame sequence of the shown result and its age since capture
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int64 ResultSequence = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float ResultAgeMs = 0.f;
+
+	// Heads as detection records, tracked and extrapolated when tracking is on
+	UFUNCTION(BlueprintPure)
+	const TArray<FVisionDetection>& GetDetections() const { return Detections; }
+	// Bumped whenever the detections change beyond the hysteresis, for consumers that poll
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int DetectionsVersion = 0;
+	// Movement in frame pixels and score change below which the detection set counts as unchanged
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float DetectionHysteresisPx = 2.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float DetectionScoreHysteresis = 0.05f;
+
+	/* Pipeline Config - UPROPERTY */
+	// Input size, thresholds, models, scheduling, tracking and preview, edits reach the reader thread together at the next frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVisionPipelineConfig PipelineConfig;
+	// JSON file under the project's Config directory loaded at BeginPlay, and again whenever it changes on disk
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString PipelineConfigFile = TEXT("Vision.json");
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bWatchPipelineConfig = true;
+
+	// Replace the pipeline config, taken over by the reader thread at the next frame
+	UFUNCTION(BlueprintCallable)
+	void ApplyPipelineConfig(const FVisionPipelineConfig& NewConfig);
+	// Load PipelineConfigFile and apply it, false when it is missing or not valid
+	UFUNCTION(BlueprintCallable)
+	bool ReloadPipelineConfig();
+	// Write the current config to PipelineConfigFile, e.g. to start a file to edit
+	UFUNCTION(BlueprintCallable)
+	bool SavePipelineConfig() const;
+
+	/* Frame Ingest Var - UPROPERTY */
+	// With UseTCP frames come from a sender on this port instead of the camera, see VisionWire.h
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 IngestPort = VisionWire::DefaultIngestPort;
+	// Stream of the port this actor reads, other actors may read the other streams
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 IngestStream = 0;
+	// Decode threads of the server, shared by every stream of the port
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 IngestDecodeThreads = 4;
+	// Frames decoded per second and frames dropped for lack of buffers, over all streams of the port
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float IngestRate = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int IngestDropped = 0;
+	// Shared memory frame ring of a capture process, see VisionWire.h. When set frames come from there instead of the camera or TCP
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString FrameRingName;
+
+	/* Detection Stream Var - UPROPERTY */
+	// Multicast every published frame's detections to other local processes, see VisionWire.h
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bPublishDetections = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString DetectionGroup = VisionWire::DefaultDetectionGroup;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 DetectionPort = VisionWire::DefaultDetectionPort;
+
+	/* Scheduler Var - UPROPERTY */
+	// Achieved rate of each model over the last second
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float Yolov5Rate = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float Yolov3Rate = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float SSDResRate = 0.f;
+	// Frames read from the camera per second
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float CaptureRate = 0.f;
+
+	/* Tracking Var - UPROPERTY */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int Yolov5TrackCount = 0;
+	// Cost of the last tracker update
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float TrackerCostUs = 0.f;
+	// Mean distance of new detections from the extrapolated and from the held previous positions, in frame pixels
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float PredictionErrorPx = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float HoldErrorPx = 0.f;
+
+	/* Preview Var - UPROPERTY */
+	// Receives the preview texture along with ShowNativeImage, no preview is produced while neither is used
+	UPROPERTY(BlueprintAssignable)
+	FOnPreviewFrame OnPreviewFrame;
+	// Game thread cost of uploading a camera frame, textures created and frames dropped while uploads were in flight
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float NativeSubmitUs = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int NativeTexturesCreated = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int NativeFramesDropped = 0;
+	// Garbage collections since BeginPlay, how long the last one took and the UObjects alive
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int GarbageCollections = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float LastGarbageCollectMs = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int LiveObjects = 0;
+
+	/* Profiling Var - UPROPERTY */
+	// Length of the rolling window the stage latency percentiles cover
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float LatencyWindowSeconds = 10.f;
+	// Capture a timeline of this many seconds from BeginPlay on, including the camera start up. 0 captures nothing
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float TimelineCaptureSeconds = 0.f;
+
+	// p50/p90/p99/p99.9/max of a pipeline stage over the rolling window
+	UFUNCTION(BlueprintPure)
+	FVisionLatencyStats GetStageLatency(EVisionStage Stage) const;
+	// Write the percentiles of every stage as JSON, returns false when the file could not be written
+	UFUNCTION(BlueprintCallable)
+	bool DumpStageLatency(const FString& Path) const;
+	// Record every stage on every thread for Seconds and write it as Chrome Trace Event JSON to Saved/Profiling
+	UFUNCTION(BlueprintCallable)
+	bool CaptureTimeline(float Seconds);
 
 	/* Show Event - UFUNCTION */
 	UFUNCTION(BlueprintImplementableEvent)
@@ -86,12 +214,19 @@ public:
 	UFUNCTION(BlueprintImplementableEvent)
 	void ShowNativeImage(UTexture2D* outRGB);
 
-	// TODO: Yolov5 Result
+	// Fired only when the detections change beyond the hysteresis, the same array GetDetections returns
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnDetectionsChanged(const TArray<FVisionDetection>& Records);
+
+	// Yolov5 centres in network input pixels, fired with OnDetectionsChanged
 	UFUNCTION(BlueprintImplementableEvent)
 	void ShowYolov5Result(int Count, const TArray<float>& CenterX, const TArray<float>& CenterY);
 	// Yolov3
 	UFUNCTION(BlueprintImplementableEvent)
 	void ShowYolov3Result(int Count);
+	// Tracked heads, centres in frame pixels at the current game time when PipelineConfig.PredictTracks is set, fired with OnDetectionsChanged
+	UFUNCTION(BlueprintImplementableEvent)
+	void ShowYolov5Tracks(int Count, const TArray<int32>& TrackID, const TArray<float>& CenterX, const TArray<float>& CenterY);
 	// ResNet SSD
 	UFUNCTION(BlueprintImplementableEvent)
 	void ShowSSDResResult(int Count, const TArray<float>& FaceX, const TArray<float>& FaceY, const TArray<float>& FaceSize);
@@ -101,20 +236,122 @@ public:
 	void DetectYolov3Body(Mat& Frame);
 	void DetectSSDResFace(Mat& Frame);
 
+	/* Hot path steps without actor state, also timed by CV.Bench.Suite */
+	// Scale to the Yolov5 input, letterboxed with the padding in Top and Left when Config.DoKeepRatio is set
+	static Mat ResizeImage(const Mat& InMat, const FVisionPipelineConfig& Config, int *Width, int *Height, int *Top, int *Left);
+	// Keep the faces of an SSD detection_out tensor above Confidence, boxes in frame pixels. Not instrumented, DetectSSDResFace times and traces it
+	static void DecodeSSDResFaces(const Mat& Output, int Width, int Height, float Confidence, FDetectionBuffer& Result);
+
 private:
 	// Define private variables and helper functions
-	float* Anchors;
+	// Reader thread copy of the config, replaced only between frames
+	FVisionPipelineConfig ActiveConfig;
+	// Last config handed to the reader thread and the one waiting for it
+	FVisionPipelineConfig AppliedConfig;
+	FVisionPipelineConfig PendingConfig;
+	FCriticalSection PendingConfigLock;
+	std::atomic<bool> bConfigPending{ false };
+	FDateTime PipelineConfigTime;
+	double NextConfigPoll = 0.0;
+
+	vector<String> Yolov5OutNames;
+	vector<Mat> Yolov5Outs;
+	vector<Mat> Yolov3Outs;
+	// Letterbox of the last resized frame
+	int NewWidth = 0;
+	int NewHeight = 0;
+	int PaddingWidth = 0;
+	int PaddingHeight = 0;
+	vector<String> Yolov3OutNames;
+	int Yolov3PersonClass = 0;
+	EYoloOutputFormat ResolvedYolov5Format = EYoloOutputFormat::Auto;
+	bool bYolov5FormatAmbiguous = false;
+	vector<int32> Survivors;
+	FDetectionBuffer RawDetections;
+	// Yolov5 NMS output down to the tracker's low threshold, Yolov5Result is the part above ConfigThreshold
+	FDetectionBuffer Yolov5Candidates;
+	float Yolov5ScoreFloor = 0.f;
+	FObjectTracker Tracker;
+	FNMSEngine NMS;
+	TArray<int32> NMSKept;
+	TArray<float> NMSScores;
+	FModelScheduler Scheduler;
+	double LastRateReport = 0.0;
+	uint64 FrameSequence = 0;
+	// Frame of the camera or the ingest server, its buffer is reused for every frame
+	FVisionFrame SourceFrame;
+	uint64 SourceTimestampUs = 0;
+	TSharedPtr<FFrameIngestServer> FrameIngest;
+	FFrameIngestServer::FStats LastIngestStats;
+	// Opened by the reader thread, which also opens it again after the producer restarts
+	TUniquePtr<FFrameRingReader> FrameRing;
+	bool bReadFrameRing = false;
+	double NextFrameRingOpen = 0.0;
+	TUniquePtr<FDetectionPublisher> DetectionStream;
+	// Capture rate counted on the reader thread over windows of about a second
+	double CaptureWindowStart = 0.0;
+	int32 CaptureWindowFrames = 0;
+	std::atomic<float> CaptureHz{ 0.f };
+	double ResultCaptureTime = 0.0;
+	TArray<FVisionDetection> Detections;
+	TArray<FVisionDetection> DispatchedDetections;
+	bool bShowYolov5ResultImplemented = false;
+	bool bShowYolov5TracksImplemented = false;
+	TArray<float> CenterXArray;
+	TArray<float> CenterYArray;
+	TArray<int32> TrackIDArray;
+	TArray<float> TrackXArray;
+	TArray<float> TrackYArray;
+	FDNNProfiler Profiler;
+	FPreviewTexture NativeTexture;
+	// The texture NativeTexture updates, referenced here for the garbage collector
+	UPROPERTY(Transient)
+	UTexture2D* CameraTexture = nullptr;
+	FDelegateHandle PreGarbageCollectHandle;
+	FDelegateHandle PostGarbageCollectHandle;
+	uint64 GarbageCollectStart = 0;
+	Mat PreviewFrame;
+	double NextPreviewTime = 0.0;
+	bool bShowNativeImplemented = false;
+	std::atomic<bool> bPreviewWanted{ false };
+	int32 Yolov5Profile = INDEX_NONE;
+	int32 Yolov3Profile = INDEX_NONE;
+	int32 SSDResProfile = INDEX_NONE;
+	// Forwards that threw, per model, only some of them are logged
+	int32 ModelFailures[FModelScheduler::NumModels] = {};
 	
-	static UTexture2D* ConvertMat2Texture2D(const Mat& InMat);
 	void InitCameraAndThreadRunnable(uint32 index);
+	void StartFrameIngest();
+	void StartFrameRing();
+	// Reader thread: the next frame into SourceFrame, false when none came
+	bool ReadSourceFrame(double& CaptureTime);
+	void ConfigureScheduler();
+	void ConfigureTracker();
+	FString GetPipelineConfigPath() const;
+	void PollPipelineConfig(double Now);
+	// Reader thread: take over a pending config at the frame boundary
+	void UpdateActiveConfig();
+	void PublishResults(double CaptureTime);
+	void SendPreview(const Mat& Frame, double CaptureTime);
+	void BuildDetections(const FDetectionSnapshot& Snapshot, double Now);
+	bool HaveDetectionsChanged() const;
+	// False when the model threw, its result of the frame is dropped
+	bool RunModel(EVisionModel Model, Mat& Frame);
+	// Reader thread: forward a blank input of the configured size, false when the loaded model does not take it
+	bool ProbeYolov5Input();
 
-	static Mat ResizeImage(Mat InMat, int *Width, int *Height, int *Top, int *Left);
 	// void CutImage(const Mat inMat, FVector2D inPos);
 	// void CutImageRect(const Mat inMat, cv::Rect inRect);
 
 	void PostProcessing(vector<Mat>& Outs, int Width, int Height, int InWidth, int InHeight);
 
+	void DecodeRawHead(const Mat& Output, float RatioWidth, float RatioHeight, FDetectionBuffer& RawResult);
+	EYoloOutputFormat ResolveYolov5Format(const vector<Mat>& Outs);
+	static void DecodeDetections(const Mat& Output, float RatioWidth, float RatioHeight, int PadWidth, int PadHeight, float ScoreThreshold, FDetectionBuffer& RawResult);
+	int KeepNMSResults(const FDetectionBuffer& RawResult, FDetectionBuffer& Result, float ScoreThreshold);
+	void KeepYolov5Results();
 	static vector<String> GetOutputsNames(const Net& net);
+	static vector<string> LoadClassNames(const FString& Path);
 	// static TArray<any> ConvertVector2TArray(const vector<any>& Vectors);
 };
 
@@ -124,20 +361,17 @@ private:
 class G_COMPILE_API FReadImageRunnable :public FRunnable
 {
 public:
+	// One reader thread per actor, so actors reading different ingest streams or cameras run side by side
 	static FReadImageRunnable* InitReadRunnable(ACVProcessor* inActor)
 	{
-		if (!ReadInstance&&FPlatformProcess::SupportsMultithreading())
-		{
-			ReadInstance=new FReadImageRunnable(inActor);
-		}
-		return ReadInstance;
+		if (!FPlatformProcess::SupportsMultithreading()) return nullptr;
+		return new FReadImageRunnable(inActor);
 	}
 
 public:
 
 	virtual bool Init() override
 	{
-		StopThreadCounter.Increment();
 		return true;
 	}
 
@@ -145,14 +379,13 @@ public:
 	{
 		if (!ReadActor)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("AHikVisionActor Actor is not spawn"));
+			UE_LOG(LogVision, Error, TEXT("AHikVisionActor Actor is not spawn"));
 			return 1;
 		}
 
 		
 		while (StopThreadCounter.GetValue())
 		{
-			UE_LOG(LogTemp, Warning, TEXT("ReadFrame"));
 			ReadActor->ReadFrame();
 		}
 
@@ -181,29 +414,31 @@ public:
 		
 	}
 
+	// Only asks the loop to end, also called by the thread object when it is deleted
 	virtual void Stop() override
 	{
-		if(ReadInstance)
-		{
-			ReadInstance->EnsureThread();
-			delete ReadInstance;
-			ReadInstance = nullptr;
-		}
-
+		StopThreadCounter.Set(0);
 	}
-	void EnsureThread()
+	// Stop this reader, wait for its thread and free both
+	void Shutdown()
 	{
-		StopThreadCounter.Decrement();
-		if (ReadImageThread) {
+		Stop();
+		if (ReadImageThread)
+		{
 			ReadImageThread->WaitForCompletion();
+			delete ReadImageThread;
+			ReadImageThread = nullptr;
 		}
+		delete this;
 	}
 protected:
 	FReadImageRunnable(ACVProcessor* inReadActor) 
 	{
 		
 		ReadActor = inReadActor;
-		ReadImageThread = FRunnableThread::Create(this, TEXT("ReadImageRunnable"));
+		// Running before the thread starts, so a Stop that comes first is not undone
+		StopThreadCounter.Set(1);
+		ReadImageThread = FRunnableThread::Create(this, *FString::Printf(TEXT("ReadImageRunnable %s"), *inReadActor->GetName()));
 	}
 
 
@@ -213,8 +448,7 @@ protected:
 
 
 private:
-	FRunnableThread* ReadImageThread;
+	FRunnableThread* ReadImageThread = nullptr;
 	ACVProcessor* ReadActor;
-	static FReadImageRunnable* ReadInstance;
 	FThreadSafeCounter StopThreadCounter;
 };
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DNNProfiler.h"
+#include "Engine/Engine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+
+int32 FDNNProfiler::RegisterNet(const FString& Name, const cv::dnn::Net& Net)
+{
+	if (Net.empty()) return INDEX_NONE;
+
+	FNetProfile& Profile = Profiles.AddDefaulted_GetRef();
+	Profile.Name = Name;
+	// getPerfProfile reports one timing per layer id, skipping the input layer 0
+	const std::vector<cv::String> Names = Net.getLayerNames();
+	for (size_t i = 0; i < Names.size(); ++i)
+	{
+		Profile.LayerNames.Add(UTF8_TO_TCHAR(Names[i].c_str()));
+		const cv::Ptr<cv::dnn::Layer> Layer = Net.getLayer(static_cast<int>(i + 1));
+		Profile.LayerTypes.Add(Layer ? UTF8_TO_TCHAR(Layer->type.c_str()) : TEXT(""));
+	}
+	Profile.LayerMs.SetNumZeroed(Profile.LayerNames.Num());
+	return Profiles.Num() - 1;
+}
+
+void FDNNProfiler::SampleInternal(int32 NetIndex, const cv::dnn::Net& Net)
+{
+	FNetProfile& Profile = Profiles[NetIndex];
+	const double MsPerTick = 1000.0 / cv::getTickFrequency();
+	Profile.TotalMs += Net.getPerfProfile(Timings) * MsPerTick;
+	const int32 NumLayers = FMath::Min(static_cast<int32>(Timings.size()), Profile.LayerMs.Num());
+	for (int32 i = 0; i < NumLayers; ++i)
+	{
+		Profile.LayerMs[i] += Timings[i] * MsPerTick;
+	}
+	if (++Profile.Frames >= WindowFrames)
+	{
+		FlushWindow(Profile);
+	}
+}
+
+void FDNNProfiler::FlushWindow(FNetProfile& Profile)
+{
+	// Layers merged into a neighbour by fusion are skipped at run time and never report any time
+	int32 FusedLayers = 0;
+	TArray<int32> Order;
+	for (int32 i = 0; i < Profile.LayerMs.Num(); ++i)
+	{
+		if (Profile.LayerMs[i] > 0.0) Order.Add(i);
+		else ++FusedLayers;
+	}
+	Order.Sort([&Profile](int32 A, int32 B) { return Profile.LayerMs[A] > Profile.LayerMs[B]; });
+	const int32 NumTop = FMath::Min(TopN, Order.Num());
+
+	const double InvFrames = 1.0 / Profile.Frames;
+	const double AvgTotalMs = Profile.TotalMs * InvFrames;
+	const FString Time = FDateTime::Now().ToString();
+	FString Csv;
+	FString Summary = FString::Printf(TEXT("%s: %.2f ms/forward, %d/%d layers fused"), *Profile.Name, AvgTotalMs, FusedLayers, Profile.LayerMs.Num());
+	for (int32 Rank = 0; Rank < NumTop; ++Rank)
+	{
+		const int32 i = Order[Rank];
+		const double AvgMs = Profile.LayerMs[i] * InvFrames;
+		const double Percent = AvgTotalMs > 0.0 ? AvgMs * 100.0 / AvgTotalMs : 0.0;
+		Csv += FString::Printf(TEXT("%s,%s,%d,%.4f,%d,%d,%s,%s,%.4f,%.2f\n"), *Time, *Profile.Name, Profile.Frames, AvgTotalMs,
+			FusedLayers, Rank + 1, *Profile.LayerNames[i], *Profile.LayerTypes[i], AvgMs, Percent);
+		Summary += FString::Printf(TEXT("\n  %2d. %s (%s) %.3f ms %.1f%%"), Rank + 1, *Profile.LayerNames[i], *Profile.LayerTypes[i], AvgMs, Percent);
+	}
+
+	const FString CsvPath = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("DNNProfile.csv");
+	if (!IFileManager::Get().FileExists(*CsvPath))
+	{
+		Csv = TEXT("Time,Net,Frames,TotalMs,FusedLayers,Rank,Layer,Type,AvgMs,Percent\n") + Csv;
+	}
+	FFileHelper::SaveStringToFile(Csv, *CsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	{
+		FScopeLock Lock(&SummaryLock);
+		Summaries.Add(Profile.Name, MoveTemp(Summary));
+	}
+
+	Profile.TotalMs = 0.0;
+	Profile.Frames = 0;
+	FMemory::Memzero(Profile.LayerMs.GetData(), Profile.LayerMs.Num() * sizeof(double));
+}
+
+void FDNNProfiler::DrawOnScreen() const
+{
+	if (!IsEnabled() || !GEngine) return;
+	FScopeLock Lock(&SummaryLock);
+	uint64 Key = 0x444E4E50;
+	for (const TPair<FString, FString>& Summary : Summaries)
+	{
+		GEngine->AddOnScreenDebugMessage(Key++, 0.f, FColor::Cyan, Summary.Value);
+	}
+}
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "OpenCVLibrary.h"
+
+#include <atomic>
+
+/*
+ * Opt-in per-layer timing of the loaded networks.
+ * After every forward the layer timings from Net::getPerfProfile are summed over a window of
+ * frames. At the end of a window the slowest layers, total inference time and fusion state are
+ * appended to a CSV file under Saved/Profiling and kept as a summary for on-screen stats.
+ * When disabled, Sample is a single branch and getPerfProfile is never called.
+ */
+class G_COMPILE_API FDNNProfiler
+{
+public:
+	void SetEnabled(bool bInEnabled) { bEnabled.store(bInEnabled, std::memory_order_relaxed); }
+	bool IsEnabled() const { return bEnabled.load(std::memory_order_relaxed); }
+	void SetWindow(int32 InWindowFrames) { WindowFrames = FMath::Max(1, InWindowFrames); }
+	void SetTopN(int32 InTopN) { TopN = FMath::Max(1, InTopN); }
+
+	// Cache layer names and types of a loaded network, returns the handle passed to Sample
+	int32 RegisterNet(const FString& Name, const cv::dnn::Net& Net);
+
+	// Collect the timings of the last forward of a registered network
+	FORCEINLINE void Sample(int32 NetIndex, const cv::dnn::Net& Net)
+	{
+		if (IsEnabled() && NetIndex != INDEX_NONE)
+		{
+			SampleInternal(NetIndex, Net);
+		}
+	}
+
+	// Show the last completed window of every network, game thread only
+	void DrawOnScreen() const;
+
+private:
+	struct FNetProfile
+	{
+		FString Name;
+		TArray<FString> LayerNames;
+		TArray<FString> LayerTypes;
+		TArray<double> LayerMs;
+		double TotalMs = 0.0;
+		int32 Frames = 0;
+	};
+
+	void SampleInternal(int32 NetIndex, const cv::dnn::Net& Net);
+	void FlushWindow(FNetProfile& Profile);
+
+	// Set by the reader thread, also read by DrawOnScreen on the game thread
+	std::atomic<bool> bEnabled{ false };
+	int32 WindowFrames = 300;
+	int32 TopN = 10;
+	TArray<FNetProfile> Profiles;
+	std::vector<double> Timings;
+
+	mutable FCriticalSection SummaryLock;
+	TMap<FString, FString> Summaries;
+};
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Detections of one frame as separate contiguous arrays, sized once with Reserve.
+ * X, Y, Width and Height are the box in frame pixels, CenterX and CenterY the box centre in the
+ * space the model decodes in (network input pixels for Yolov5, frame pixels for tracks). TrackID
+ * is INDEX_NONE and the velocity in frame pixels per second zero for plain detections. Adding
+ * past the capacity is
+ * refused rather than growing, so the hot path never allocates.
+ */
+struct FDetectionBuffer
+{
+	int32 Count = 0;
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Width;
+	TArray<float> Height;
+	TArray<float> CenterX;
+	TArray<float> CenterY;
+	TArray<float> Score;
+	TArray<int32> ClassID;
+	TArray<int32> TrackID;
+	TArray<float> VelocityX;
+	TArray<float> VelocityY;
+
+	void Reserve(int32 InCapacity)
+	{
+		X.SetNumUninitialized(InCapacity);
+		Y.SetNumUninitialized(InCapacity);
+		Width.SetNumUninitialized(InCapacity);
+		Height.SetNumUninitialized(InCapacity);
+		CenterX.SetNumUninitialized(InCapacity);
+		CenterY.SetNumUninitialized(InCapacity);
+		Score.SetNumUninitialized(InCapacity);
+		ClassID.SetNumUninitialized(InCapacity);
+		TrackID.SetNumUninitialized(InCapacity);
+		VelocityX.SetNumUninitialized(InCapacity);
+		VelocityY.SetNumUninitialized(InCapacity);
+		Count = 0;
+	}
+
+	int32 Capacity() const { return X.Num(); }
+	void Reset() { Count = 0; }
+
+	FORCEINLINE bool Add(float InX, float InY, float InWidth, float InHeight, float InCenterX, float InCenterY, float InScore, int32 InClassID,
+		int32 InTrackID = INDEX_NONE, float InVelocityX = 0.f, float InVelocityY = 0.f)
+	{
+		if (Count >= X.Num()) return false;
+		X[Count] = InX;
+		Y[Count] = InY;
+		Width[Count] = InWidth;
+		Height[Count] = InHeight;
+		CenterX[Count] = InCenterX;
+		CenterY[Count] = InCenterY;
+		Score[Count] = InScore;
+		ClassID[Count] = InClassID;
+		TrackID[Count] = InTrackID;
+		VelocityX[Count] = InVelocityX;
+		VelocityY[Count] = InVelocityY;
+		++Count;
+		return true;
+	}
+
+	// Append detection Index of Source, with its score replaced by InScore
+	FORCEINLINE bool AddFrom(const FDetectionBuffer& Source, int32 Index, float InScore)
+	{
+		return Add(Source.X[Index], Source.Y[Index], Source.Width[Index], Source.Height[Index],
+			Source.CenterX[Index], Source.CenterY[Index], InScore, Source.ClassID[Index],
+			Source.TrackID[Index], Source.VelocityX[Index], Source.VelocityY[Index]);
+	}
+
+	// Replace the contents with Source, up to the capacity
+	void CopyFrom(const FDetectionBuffer& Source)
+	{
+		Count = FMath::Min(Source.Count, Capacity());
+		const SIZE_T FloatBytes = Count * sizeof(float);
+		FMemory::Memcpy(X.GetData(), Source.X.GetData(), FloatBytes);
+		FMemory::Memcpy(Y.GetData(), Source.Y.GetData(), FloatBytes);
+		FMemory::Memcpy(Width.GetData(), Source.Width.GetData(), FloatBytes);
+		FMemory::Memcpy(Height.GetData(), Source.Height.GetData(), FloatBytes);
+		FMemory::Memcpy(CenterX.GetData(), Source.CenterX.GetData(), FloatBytes);
+		FMemory::Memcpy(CenterY.GetData(), Source.CenterY.GetData(), FloatBytes);
+		FMemory::Memcpy(Score.GetData(), Source.Score.GetData(), FloatBytes);
+		FMemory::Memcpy(ClassID.GetData(), Source.ClassID.GetData(), Count * sizeof(int32));
+		FMemory::Memcpy(TrackID.GetData(), Source.TrackID.GetData(), Count * sizeof(int32));
+		FMemory::Memcpy(VelocityX.GetData(), Source.VelocityX.GetData(), FloatBytes);
+		FMemory::Memcpy(VelocityY.GetData(), Source.VelocityY.GetData(), FloatBytes);
+	}
+
+	// Copy one column into a Blueprint array, reusing its allocation
+	template<typename ElementType>
+	void CopyColumn(const TArray<ElementType>& Column, TArray<ElementType>& Out) const
+	{
+		Out.SetNumUninitialized(Count, false);
+		FMemory::Memcpy(Out.GetData(), Column.GetData(), Count * sizeof(ElementType));
+	}
+};
+
+/* Results of every model as of one captured frame, published to the game thread as a whole */
+struct FDetectionSnapshot
+{
+	uint64 Sequence = 0;       // Captured frame the newest result belongs to
+	double CaptureTime = 0.0;  // FPlatformTime::Seconds when the frame was read
+	double PublishTime = 0.0;
+	uint64 SourceTimestampUs = 0; // Capture time from the frame source, the sender's clock for ingested frames
+	bool bTracked = false;     // Yolov5Tracks is filled, tracking was on for the frame
+	FDetectionBuffer Yolov5;
+	FDetectionBuffer Yolov3;
+	FDetectionBuffer SSDRes;
+	FDetectionBuffer Yolov5Tracks;
+};
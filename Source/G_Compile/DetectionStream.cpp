@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DetectionStream.h"
+#include "Async/Async.h"
+#include "Common/UdpSocketBuilder.h"
+#include "IPAddress.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "VisionLog.h"
+
+FDetectionPublisher::~FDetectionPublisher()
+{
+	bRunning = false;
+	if (PacketReady)
+	{
+		PacketReady->Trigger();
+		Sender.Wait();
+		FPlatformProcess::ReturnSynchEventToPool(PacketReady);
+	}
+	if (Socket)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+	}
+}
+
+bool FDetectionPublisher::Start(const FString& Group, int32 Port)
+{
+	ISocketSubsystem* Sockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	bool bValid = false;
+	Destination = Sockets->CreateInternetAddr();
+	Destination->SetIp(*Group, bValid);
+	Destination->SetPort(Port);
+	if (!bValid)
+	{
+		UE_LOG(LogVision, Error, TEXT("Detection Stream Group %s Is Not An Address"), *Group);
+		return false;
+	}
+	// Sent on the loopback interface and looped back, so only subscribers on this machine get the datagrams.
+	// A TTL of 1 alone would still put them on the subnet of the default interface
+	FIPv4Address Interface;
+	FIPv4Address::Parse(VisionWire::DetectionInterface, Interface);
+	Socket = FUdpSocketBuilder(TEXT("VisionDetections"))
+		.AsNonBlocking()
+		.AsReusable()
+		.WithMulticastInterface(Interface)
+		.WithMulticastLoopback()
+		.WithMulticastTtl(1)
+		.WithSendBufferSize(VisionWire::MaxDetectionPacketSize * 4)
+		.Build();
+	if (!Socket)
+	{
+		UE_LOG(LogVision, Error, TEXT("Detection Stream Could Not Create A Socket"));
+		return false;
+	}
+
+	Packets.ForEachSlot([](TArray<uint8>& Packet) { Packet.Reserve(VisionWire::MaxDetectionPacketSize); });
+	PacketReady = FPlatformProcess::GetSynchEventFromPool(false);
+	bRunning = true;
+	Sender = Async(EAsyncExecution::Thread, [this]() { SendLoop(); });
+	UE_LOG(LogVision, Log, TEXT("Detection Stream Publishing To %s:%d"), *Group, Port);
+	return true;
+}
+
+void FDetectionPublisher::Append(TArray<uint8>& Packet, const FDetectionBuffer& Buffer, VisionWire::EDetectionSource Source)
+{
+	const int32 Room = static_cast<int32>((VisionWire::MaxDetectionPacketSize - Packet.Num()) / sizeof(VisionWire::FDetectionRecord));
+	const int32 Count = FMath::Min(Buffer.Count, Room);
+	const int32 Offset = Packet.Num();
+	Packet.SetNumUninitialized(Offset + Count * sizeof(VisionWire::FDetectionRecord), false);
+	VisionWire::FDetectionRecord* Records = reinterpret_cast<VisionWire::FDetectionRecord*>(Packet.GetData() + Offset);
+	for (int32 i = 0; i < Count; ++i)
+	{
+		VisionWire::FDetectionRecord& Record = Records[i];
+		Record.Id = Source == VisionWire::EDetectionSource::Yolov5Track ? Buffer.TrackID[i] : -1;
+		Record.X = Buffer.X[i];
+		Record.Y = Buffer.Y[i];
+		Record.Width = Buffer.Width[i];
+		Record.Height = Buffer.Height[i];
+		Record.Score = Buffer.Score[i];
+		Record.Class = static_cast<uint16_t>(FMath::Clamp(Buffer.ClassID[i], 0, 0xFFFF));
+		Record.Source = static_cast<uint8_t>(Source);
+		Record.Reserved = 0;
+	}
+}
+
+void FDetectionPublisher::Publish(const FDetectionSnapshot& Snapshot, int32 FrameWidth, int32 FrameHeight)
+{
+	if (!bRunning) return;
+	TArray<uint8>& Packet = Packets.GetWriteBuffer();
+	Packet.SetNumUninitialized(sizeof(VisionWire::FDetectionPacketHeader), false);
+	Append(Packet, Snapshot.Yolov5, VisionWire::EDetectionSource::Yolov5Head);
+	Append(Packet, Snapshot.Yolov5Tracks, VisionWire::EDetectionSource::Yolov5Track);
+	Append(Packet, Snapshot.Yolov3, VisionWire::EDetectionSource::Yolov3Body);
+	Append(Packet, Snapshot.SSDRes, VisionWire::EDetectionSource::SSDResFace);
+
+	VisionWire::FDetectionPacketHeader& Header = *reinterpret_cast<VisionWire::FDetectionPacketHeader*>(Packet.GetData());
+	Header.Magic = VisionWire::DetectionMagic;
+	Header.Version = VisionWire::DetectionVersion;
+	Header.Count = static_cast<uint16_t>((Packet.Num() - sizeof(VisionWire::FDetectionPacketHeader)) / sizeof(VisionWire::FDetectionRecord));
+	Header.Sequence = Snapshot.Sequence;
+	Header.TimestampUs = Snapshot.SourceTimestampUs;
+	Header.FrameWidth = static_cast<uint16_t>(FrameWidth);
+	Header.FrameHeight = static_cast<uint16_t>(FrameHeight);
+	Header.Reserved = 0;
+	Packets.Publish();
+	PublishedCount.fetch_add(1, std::memory_order_relaxed);
+	PacketReady->Trigger();
+}
+
+void FDetectionPublisher::SendLoop()
+{
+	while (bRunning)
+	{
+		if (!Packets.Acquire())
+		{
+			PacketReady->Wait(FTimespan::FromMilliseconds(100));
+			continue;
+		}
+		const TArray<uint8>& Packet = Packets.Read();
+		int32 Sent = 0;
+		// Non-blocking, a full send buffer loses this packet rather than holding up the next
+		if (Socket->SendTo(Packet.GetData(), Packet.Num(), Sent, *Destination) && Sent == Packet.Num())
+		{
+			SentCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
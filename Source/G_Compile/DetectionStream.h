@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "DetectionBuffer.h"
+#include "TripleBuffer.h"
+#include "VisionWire.h"
+
+#include <atomic>
+
+class FSocket;
+class FInternetAddr;
+
+/*
+ * Publishes the detections of every frame to other local processes as UDP multicast datagrams
+ * (see VisionWire.h for the packet, Tools/VisionDetectionSubscriber.cpp for a subscriber).
+ * The reader thread only writes the packet into a triple buffer. A sender thread of its own puts
+ * it on the socket, so a slow or absent network never stalls inference, and a packet the sender
+ * did not get to is replaced by the next one.
+ */
+class G_COMPILE_API FDetectionPublisher
+{
+public:
+	~FDetectionPublisher();
+
+	// Open the socket and start the sender thread, false when there is no socket
+	bool Start(const FString& Group, int32 Port);
+	// Reader thread: encode the snapshot into the next packet, never waits
+	void Publish(const FDetectionSnapshot& Snapshot, int32 FrameWidth, int32 FrameHeight);
+
+	int32 GetPublishedCount() const { return PublishedCount.load(std::memory_order_relaxed); }
+	int32 GetSentCount() const { return SentCount.load(std::memory_order_relaxed); }
+
+private:
+	static void Append(TArray<uint8>& Packet, const FDetectionBuffer& Buffer, VisionWire::EDetectionSource Source);
+	void SendLoop();
+
+	TLockFreeTripleBuffer<TArray<uint8>> Packets;
+	FSocket* Socket = nullptr;
+	TSharedPtr<FInternetAddr> Destination;
+	FEvent* PacketReady = nullptr;
+	TFuture<void> Sender;
+	std::atomic<bool> bRunning{ false };
+	std::atomic<int32> PublishedCount{ 0 };
+	std::atomic<int32> SentCount{ 0 };
+};
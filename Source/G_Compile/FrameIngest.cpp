@@ -0,0 +1,354 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FrameIngest.h"
+#include "Async/Async.h"
+#include "Common/TcpListener.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "VisionLog.h"
+#include "VisionStats.h"
+
+namespace
+{
+	// How long blocked threads wait before looking at bRunning again
+	const FTimespan PollInterval = FTimespan::FromMilliseconds(100);
+	// Room for a few raw 1080p frames in the kernel
+	constexpr int32 SocketBufferSize = 16 * 1024 * 1024;
+
+	FCriticalSection ServersLock;
+	TMap<int32, TWeakPtr<FFrameIngestServer>> Servers;
+}
+
+TSharedPtr<FFrameIngestServer> FFrameIngestServer::Acquire(int32 Port, int32 NumDecodeThreads)
+{
+	FScopeLock Lock(&ServersLock);
+	if (TSharedPtr<FFrameIngestServer> Existing = Servers.FindRef(Port).Pin())
+	{
+		return Existing;
+	}
+	TSharedPtr<FFrameIngestServer> Server = MakeShareable(new FFrameIngestServer());
+	if (!Server->Start(Port, NumDecodeThreads)) return nullptr;
+	Servers.Add(Port, Server);
+	return Server;
+}
+
+bool FFrameIngestServer::Start(int32 InPort, int32 NumDecodeThreads)
+{
+	Port = InPort;
+	for (FMailbox& Mailbox : Mailboxes)
+	{
+		Mailbox.Ready = FPlatformProcess::GetSynchEventFromPool(false);
+	}
+	JobReady = FPlatformProcess::GetSynchEventFromPool(false);
+	Jobs.Reserve(NumConnectionBuffers * VisionWire::MaxStreams);
+
+	bRunning = true;
+	Listener = MakeUnique<FTcpListener>(FIPv4Endpoint(FIPv4Address::Any, static_cast<uint16>(Port)), PollInterval);
+	if (!Listener->IsActive())
+	{
+		UE_LOG(LogVision, Error, TEXT("Frame Ingest Could Not Listen On Port %d"), Port);
+		return false;
+	}
+	Listener->OnConnectionAccepted().BindRaw(this, &FFrameIngestServer::HandleAccept);
+
+	for (int32 i = 0; i < FMath::Max(1, NumDecodeThreads); ++i)
+	{
+		Decoders.Add(Async(EAsyncExecution::Thread, [this]() { DecodeLoop(); }));
+	}
+	UE_LOG(LogVision, Log, TEXT("Frame Ingest Listening On Port %d With %d Decode Threads"), Port, Decoders.Num());
+	return true;
+}
+
+FFrameIngestServer::~FFrameIngestServer()
+{
+	{
+		FScopeLock Lock(&ServersLock);
+		if (!Servers.FindRef(Port).IsValid()) Servers.Remove(Port);
+	}
+	bRunning = false;
+	// Stops accepting before the connections go away
+	Listener.Reset();
+	FScopeLock Lock(&ConnectionsLock);
+	for (TUniquePtr<FConnection>& Connection : Connections)
+	{
+		Connection->Task.Wait();
+	}
+	// Decoders still hold buffers of the connections, they finish before those are freed
+	for (int32 i = 0; i < Decoders.Num(); ++i)
+	{
+		JobReady->Trigger();
+	}
+	for (TFuture<void>& Decoder : Decoders)
+	{
+		Decoder.Wait();
+	}
+	for (TUniquePtr<FConnection>& Connection : Connections)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Connection->Socket);
+	}
+	Connections.Reset();
+	if (JobReady) FPlatformProcess::ReturnSynchEventToPool(JobReady);
+	for (FMailbox& Mailbox : Mailboxes)
+	{
+		if (Mailbox.Ready) FPlatformProcess::ReturnSynchEventToPool(Mailbox.Ready);
+	}
+}
+
+void FFrameIngestServer::Subscribe(int32 Stream)
+{
+	if (Stream < 0 || Stream >= VisionWire::MaxStreams) return;
+	Mailboxes[Stream].Subscribers.fetch_add(1);
+}
+
+void FFrameIngestServer::Unsubscribe(int32 Stream)
+{
+	if (Stream < 0 || Stream >= VisionWire::MaxStreams) return;
+	Mailboxes[Stream].Subscribers.fetch_sub(1);
+}
+
+bool FFrameIngestServer::WaitForFrame(int32 Stream, FVisionFrame& Frame, double TimeoutSeconds)
+{
+	if (Stream < 0 || Stream >= VisionWire::MaxStreams) return false;
+	FMailbox& Mailbox = Mailboxes[Stream];
+	for (int32 Attempt = 0; Attempt < 2; ++Attempt)
+	{
+		{
+			FScopeLock Lock(&Mailbox.Lock);
+			if (Mailbox.bFresh)
+			{
+				cv::swap(Frame.Image, Mailbox.Latest.Image);
+				Frame.Sequence = Mailbox.Latest.Sequence;
+				Frame.TimestampUs = Mailbox.Latest.TimestampUs;
+				Frame.ReceiveTime = Mailbox.Latest.ReceiveTime;
+				Frame.Stream = Stream;
+				Mailbox.bFresh = false;
+				return true;
+			}
+		}
+		if (Attempt == 0 && !Mailbox.Ready->Wait(FTimespan::FromSeconds(TimeoutSeconds))) return false;
+	}
+	return false;
+}
+
+FFrameIngestServer::FStats FFrameIngestServer::GetStats() const
+{
+	FStats Stats;
+	Stats.Time = FPlatformTime::Seconds();
+	Stats.Decoded = DecodedCount.load(std::memory_order_relaxed);
+	Stats.ReceivedBytes = ReceivedBytes.load(std::memory_order_relaxed);
+	Stats.DecodeCycles = DecodeCycles.load(std::memory_order_relaxed);
+	Stats.Dropped = DroppedCount.load(std::memory_order_relaxed);
+	FScopeLock Lock(&ConnectionsLock);
+	for (const TUniquePtr<FConnection>& Connection : Connections)
+	{
+		Stats.Connections += Connection->bFinished ? 0 : 1;
+	}
+	return Stats;
+}
+
+FFrameIngestServer::FRates FFrameIngestServer::GetRates(const FStats& Previous, const FStats& Current)
+{
+	const double Elapsed = FMath::Max(1e-3, Current.Time - Previous.Time);
+	const int64 Decoded = Current.Decoded - Previous.Decoded;
+	FRates Rates;
+	Rates.FramesPerSecond = static_cast<float>(Decoded / Elapsed);
+	Rates.MegabytesPerSecond = static_cast<float>((Current.ReceivedBytes - Previous.ReceivedBytes) / Elapsed / (1024.0 * 1024.0));
+	Rates.DecodeMs = Decoded > 0 ? static_cast<float>(FPlatformTime::ToMilliseconds64(Current.DecodeCycles - Previous.DecodeCycles) / Decoded) : 0.f;
+	Rates.Dropped = Current.Dropped - Previous.Dropped;
+	return Rates;
+}
+
+bool FFrameIngestServer::FConnection::IsIdle() const
+{
+	if (!bFinished) return false;
+	for (const FReceiveBuffer& Buffer : Buffers)
+	{
+		if (Buffer.bBusy.load(std::memory_order_acquire)) return false;
+	}
+	return true;
+}
+
+// Listener thread: every connection gets a receive thread, finished ones are cleaned up here
+bool FFrameIngestServer::HandleAccept(FSocket* Socket, const FIPv4Endpoint& Endpoint)
+{
+	if (!bRunning) return false;
+	int32 ActualSize = 0;
+	Socket->SetReceiveBufferSize(SocketBufferSize, ActualSize);
+	Socket->SetNonBlocking(false);
+
+	FScopeLock Lock(&ConnectionsLock);
+	for (int32 i = Connections.Num() - 1; i >= 0; --i)
+	{
+		if (Connections[i]->IsIdle())
+		{
+			Connections[i]->Task.Wait();
+			ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Connections[i]->Socket);
+			Connections.RemoveAtSwap(i, 1, false);
+		}
+	}
+	TUniquePtr<FConnection>& Connection = Connections.Add_GetRef(MakeUnique<FConnection>());
+	Connection->Socket = Socket;
+	Connection->Peer = Endpoint.ToString();
+	FConnection* Raw = Connection.Get();
+	Connection->Task = Async(EAsyncExecution::Thread, [this, Raw]() { ReceiveLoop(*Raw); });
+	UE_LOG(LogVision, Log, TEXT("Frame Ingest Connection From %s"), *Connection->Peer);
+	return true;
+}
+
+bool FFrameIngestServer::ReceiveAll(FSocket* Socket, uint8* Data, int32 Size) const
+{
+	int32 Done = 0;
+	while (Done < Size)
+	{
+		if (!bRunning) return false;
+		if (!Socket->Wait(ESocketWaitConditions::WaitForRead, PollInterval)) continue;
+		int32 Read = 0;
+		if (!Socket->Recv(Data + Done, Size - Done, Read) || Read <= 0) return false;
+		Done += Read;
+	}
+	return true;
+}
+
+void FFrameIngestServer::ReceiveLoop(FConnection& Connection)
+{
+	VisionWire::FFrameHeader Header;
+	while (bRunning)
+	{
+		if (!ReceiveAll(Connection.Socket, reinterpret_cast<uint8*>(&Header), sizeof(Header))) break;
+		const double ReceiveTime = FPlatformTime::Seconds();
+		const uint64 ReceiveCycles = FPlatformTime::Cycles64();
+		// A raw frame is exactly its pixels, so Decode never reads past the payload
+		const uint32 BytesPerPixel = VisionWire::GetBytesPerPixel(Header.Format);
+		const bool bRaw = BytesPerPixel > 0;
+		if (Header.Magic != VisionWire::FrameMagic || Header.Version != VisionWire::FrameVersion
+			|| Header.PayloadSize == 0 || Header.PayloadSize > VisionWire::MaxFramePayload || Header.Stream >= VisionWire::MaxStreams
+			|| (!bRaw && Header.Format != static_cast<uint8>(VisionWire::EFrameFormat::Jpeg))
+			|| Header.Width == 0 || Header.Height == 0 || Header.Width > VisionWire::MaxFrameWidth || Header.Height > VisionWire::MaxFrameHeight
+			|| (bRaw && Header.PayloadSize != static_cast<uint64>(Header.Width) * Header.Height * BytesPerPixel))
+		{
+			UE_LOG(LogVision, Warning, TEXT("Frame Ingest Closing %s After An Invalid Header"), *Connection.Peer);
+			break;
+		}
+		ReceivedBytes.fetch_add(sizeof(Header) + Header.PayloadSize, std::memory_order_relaxed);
+
+		FReceiveBuffer* Free = nullptr;
+		if (Mailboxes[Header.Stream].Subscribers.load(std::memory_order_relaxed) > 0)
+		{
+			for (FReceiveBuffer& Buffer : Connection.Buffers)
+			{
+				if (!Buffer.bBusy.load(std::memory_order_acquire))
+				{
+					Free = &Buffer;
+					break;
+				}
+			}
+			if (!Free) DroppedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (!Free)
+		{
+			// Still read, the stream has to stay framed
+			Connection.Discard.SetNumUninitialized(Header.PayloadSize, false);
+			if (!ReceiveAll(Connection.Socket, Connection.Discard.GetData(), Header.PayloadSize)) break;
+			continue;
+		}
+
+		Free->Data.SetNumUninitialized(Header.PayloadSize, false);
+		if (!ReceiveAll(Connection.Socket, Free->Data.GetData(), Header.PayloadSize)) break;
+		Free->Header = Header;
+		Free->ReceiveTime = ReceiveTime;
+		Free->ReceiveCycles = ReceiveCycles;
+		Free->bBusy.store(true, std::memory_order_release);
+		{
+			FScopeLock Lock(&JobsLock);
+			Jobs.Add({ Free });
+		}
+		JobReady->Trigger();
+	}
+	UE_LOG(LogVision, Log, TEXT("Frame Ingest Connection From %s Closed"), *Connection.Peer);
+	Connection.bFinished = true;
+}
+
+void FFrameIngestServer::DecodeLoop()
+{
+	// Each decoder keeps one image, it trades it with the mailbox so the buffers circulate instead of being allocated
+	cv::Mat Image;
+	while (bRunning)
+	{
+		FDecodeJob Job{ nullptr };
+		{
+			FScopeLock Lock(&JobsLock);
+			if (Jobs.Num() > 0)
+			{
+				Job = Jobs[0];
+				Jobs.RemoveAt(0, 1, false);
+			}
+		}
+		if (!Job.Buffer)
+		{
+			JobReady->Wait(PollInterval);
+			continue;
+		}
+
+		const uint64 Start = FPlatformTime::Cycles64();
+		Decode(*Job.Buffer, Image);
+		DecodeCycles.fetch_add(FPlatformTime::Cycles64() - Start, std::memory_order_relaxed);
+		if (!Image.empty())
+		{
+			Deliver(*Job.Buffer, Image);
+		}
+		Job.Buffer->bBusy.store(false, std::memory_order_release);
+	}
+}
+
+void FFrameIngestServer::Decode(const FReceiveBuffer& Buffer, cv::Mat& Out) const
+{
+	VISION_SCOPED_STAGE(IngestDecode);
+	const VisionWire::FFrameHeader& Header = Buffer.Header;
+	uint8* Data = const_cast<uint8*>(Buffer.Data.GetData());
+	// Header sizes are capped by ReceiveLoop, still counted in 64 bits so no header can wrap them
+	const int64 Pixels = static_cast<int64>(Header.Width) * Header.Height;
+	switch (static_cast<VisionWire::EFrameFormat>(Header.Format))
+	{
+	case VisionWire::EFrameFormat::Jpeg:
+		// Decodes into Out's buffer when the size matches
+		cv::imdecode(cv::Mat(1, Buffer.Data.Num(), CV_8U, Data), cv::IMREAD_COLOR, &Out);
+		// The JPEG carries its own size, held to the same cap as the header
+		if (!Out.empty() && Out.cols <= static_cast<int>(VisionWire::MaxFrameWidth) && Out.rows <= static_cast<int>(VisionWire::MaxFrameHeight)) return;
+		break;
+	case VisionWire::EFrameFormat::BGR8:
+		if (Pixels == 0 || Buffer.Data.Num() < Pixels * 3) break;
+		cv::Mat(Header.Height, Header.Width, CV_8UC3, Data).copyTo(Out);
+		return;
+	case VisionWire::EFrameFormat::BGRA8:
+		if (Pixels == 0 || Buffer.Data.Num() < Pixels * 4) break;
+		cv::cvtColor(cv::Mat(Header.Height, Header.Width, CV_8UC4, Data), Out, cv::COLOR_BGRA2BGR);
+		return;
+	default:
+		break;
+	}
+	Out.release();
+	UE_LOG(LogVision, Verbose, TEXT("Frame Ingest Could Not Decode Frame %llu Of Stream %d"), Header.Sequence, Header.Stream);
+}
+
+void FFrameIngestServer::Deliver(const FReceiveBuffer& Buffer, cv::Mat& Image)
+{
+	FMailbox& Mailbox = Mailboxes[Buffer.Header.Stream];
+	{
+		FScopeLock Lock(&Mailbox.Lock);
+		// Decoders finish out of order, an older frame never replaces a newer one. A large step back is a restarted sender
+		const uint64 Sequence = Buffer.Header.Sequence;
+		if (Sequence <= Mailbox.LastSequence && Mailbox.LastSequence - Sequence < 64 && Mailbox.LastSequence != 0) return;
+		Mailbox.LastSequence = Sequence;
+		cv::swap(Mailbox.Latest.Image, Image);
+		Mailbox.Latest.Sequence = Sequence;
+		Mailbox.Latest.TimestampUs = Buffer.Header.TimestampUs;
+		Mailbox.Latest.ReceiveTime = Buffer.ReceiveTime;
+		Mailbox.bFresh = true;
+	}
+	Mailbox.Ready->Trigger();
+	DecodedCount.fetch_add(1, std::memory_order_relaxed);
+	// Arrival of the header to the image being ready for the pipeline
+	FVisionLatency::Get().Record(EVisionStage::Ingest, static_cast<uint64>(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - Buffer.ReceiveCycles) * 1e9));
+}
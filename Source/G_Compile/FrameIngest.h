@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "OpenCVLibrary.h"
+#include "VisionWire.h"
+
+#include <atomic>
+
+class FSocket;
+class FTcpListener;
+struct FIPv4Endpoint;
+
+/* A decoded frame as it enters the pipeline */
+struct FVisionFrame
+{
+	cv::Mat Image;
+	// Sequence and timestamp from the source, the sender's clock for network frames
+	uint64 Sequence = 0;
+	uint64 TimestampUs = 0;
+	// FPlatformTime::Seconds when the frame arrived
+	double ReceiveTime = 0.0;
+	int32 Stream = 0;
+};
+
+/*
+ * TCP server for frames captured on another machine or process (see VisionWire.h for the framing).
+ * Every connection has its own receive thread that reads whole frames into a few pooled buffers.
+ * A shared pool of decode threads turns them into BGR images and leaves the newest one per stream
+ * in a mailbox, where the reader thread of the ACVProcessor bound to that stream picks it up.
+ * Frames of streams nobody reads are skipped without being decoded, and a frame is dropped when
+ * all buffers of its connection are still waiting for decode, so a slow pipeline never backs up
+ * the senders. One server is shared by every actor using the same port.
+ */
+class G_COMPILE_API FFrameIngestServer
+{
+public:
+	static constexpr int32 NumConnectionBuffers = 4;
+
+	// Totals since the server started, a caller keeps its previous FStats and gets rates from GetRates
+	struct FStats
+	{
+		double Time = 0.0;
+		int64 Decoded = 0;
+		uint64 ReceivedBytes = 0;
+		uint64 DecodeCycles = 0;
+		int32 Dropped = 0;
+		int32 Connections = 0;
+	};
+
+	struct FRates
+	{
+		float FramesPerSecond = 0.f;
+		float MegabytesPerSecond = 0.f;
+		float DecodeMs = 0.f;
+		int32 Dropped = 0;
+	};
+
+	// The server listening on Port, started on first use. Null when the port cannot be opened
+	static TSharedPtr<FFrameIngestServer> Acquire(int32 Port, int32 NumDecodeThreads);
+	~FFrameIngestServer();
+
+	void Subscribe(int32 Stream);
+	void Unsubscribe(int32 Stream);
+	// Wait for a frame of Stream newer than the last one taken. Frame.Image trades buffers with the mailbox, so nothing is allocated
+	bool WaitForFrame(int32 Stream, FVisionFrame& Frame, double TimeoutSeconds);
+
+	// The server is shared, so nothing here depends on who asked before
+	FStats GetStats() const;
+	// Rates between two GetStats results of the same caller
+	static FRates GetRates(const FStats& Previous, const FStats& Current);
+	int32 GetPort() const { return Port; }
+
+private:
+	struct FReceiveBuffer
+	{
+		TArray<uint8> Data;
+		VisionWire::FFrameHeader Header;
+		double ReceiveTime = 0.0;
+		uint64 ReceiveCycles = 0;
+		std::atomic<bool> bBusy{ false };
+	};
+
+	struct FConnection
+	{
+		FSocket* Socket = nullptr;
+		FString Peer;
+		FReceiveBuffer Buffers[NumConnectionBuffers];
+		TArray<uint8> Discard;
+		TFuture<void> Task;
+		std::atomic<bool> bFinished{ false };
+
+		bool IsIdle() const;
+	};
+
+	struct FDecodeJob
+	{
+		FReceiveBuffer* Buffer;
+	};
+
+	struct FMailbox
+	{
+		FCriticalSection Lock;
+		FEvent* Ready = nullptr;
+		FVisionFrame Latest;
+		bool bFresh = false;
+		uint64 LastSequence = 0;
+		std::atomic<int32> Subscribers{ 0 };
+	};
+
+	FFrameIngestServer() = default;
+	bool Start(int32 InPort, int32 NumDecodeThreads);
+	bool HandleAccept(FSocket* Socket, const FIPv4Endpoint& Endpoint);
+	void ReceiveLoop(FConnection& Connection);
+	void DecodeLoop();
+	bool ReceiveAll(FSocket* Socket, uint8* Data, int32 Size) const;
+	void Decode(const FReceiveBuffer& Buffer, cv::Mat& Out) const;
+	void Deliver(const FReceiveBuffer& Buffer, cv::Mat& Image);
+
+	int32 Port = 0;
+	std::atomic<bool> bRunning{ false };
+	TUniquePtr<FTcpListener> Listener;
+	mutable FCriticalSection ConnectionsLock;
+	TArray<TUniquePtr<FConnection>> Connections;
+
+	FCriticalSection JobsLock;
+	TArray<FDecodeJob> Jobs;
+	FEvent* JobReady = nullptr;
+	TArray<TFuture<void>> Decoders;
+
+	FMailbox Mailboxes[VisionWire::MaxStreams];
+
+	std::atomic<int64> DecodedCount{ 0 };
+	std::atomic<int32> DroppedCount{ 0 };
+	std::atomic<uint64> ReceivedBytes{ 0 };
+	std::atomic<uint64> DecodeCycles{ 0 };
+};
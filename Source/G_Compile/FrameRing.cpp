@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FrameRing.h"
+#include "VisionLog.h"
+
+namespace
+{
+	const uint32 ReadWriteAccess = static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Read) | static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Write);
+}
+
+TUniquePtr<FFrameRingReader> FFrameRingReader::Open(const FString& Name)
+{
+	// The geometry is in the header, so the header is mapped alone first
+	FPlatformMemory::FSharedMemoryRegion* Probe = FPlatformMemory::MapNamedSharedMemoryRegion(Name, false, ReadWriteAccess, VisionWire::RingHeaderSize);
+	if (!Probe)
+	{
+		UE_LOG(LogVision, Verbose, TEXT("Frame Ring %s Not Found"), *Name);
+		return nullptr;
+	}
+	const VisionWire::FRingHeader* ProbeHeader = static_cast<const VisionWire::FRingHeader*>(Probe->GetAddress());
+	const bool bValid = ProbeHeader->Magic.load() == VisionWire::RingMagic && ProbeHeader->Version == VisionWire::RingVersion
+		&& ProbeHeader->NumSlots > 0 && ProbeHeader->SlotSize > VisionWire::RingSlotHeaderSize;
+	const uint32 NumSlots = ProbeHeader->NumSlots;
+	const uint32 SlotSize = ProbeHeader->SlotSize;
+	const uint32 Generation = ProbeHeader->Generation.load();
+	FPlatformMemory::UnmapNamedSharedMemoryRegion(Probe);
+	if (!bValid)
+	{
+		UE_LOG(LogVision, Warning, TEXT("Frame Ring %s Is Not A Version %d Ring"), *Name, VisionWire::RingVersion);
+		return nullptr;
+	}
+
+	TUniquePtr<FFrameRingReader> Ring(new FFrameRingReader());
+	Ring->Region = FPlatformMemory::MapNamedSharedMemoryRegion(Name, false, ReadWriteAccess, VisionWire::RingHeaderSize + static_cast<SIZE_T>(NumSlots) * SlotSize);
+	if (!Ring->Region)
+	{
+		UE_LOG(LogVision, Warning, TEXT("Frame Ring %s Could Not Be Mapped"), *Name);
+		return nullptr;
+	}
+	Ring->Base = static_cast<uint8*>(Ring->Region->GetAddress());
+	Ring->Header = reinterpret_cast<VisionWire::FRingHeader*>(Ring->Base);
+	Ring->NumSlots = NumSlots;
+	Ring->SlotSize = SlotSize;
+	Ring->Generation = Generation;
+	for (int32 i = 0; i < static_cast<int32>(VisionWire::MaxRingReaders); ++i)
+	{
+		uint32 Expected = 0;
+		if (Ring->Header->Readers[i].compare_exchange_strong(Expected, 1))
+		{
+			Ring->Reader = i;
+			break;
+		}
+	}
+	if (Ring->Reader == INDEX_NONE)
+	{
+		UE_LOG(LogVision, Error, TEXT("Frame Ring %s Already Has %d Readers"), *Name, VisionWire::MaxRingReaders);
+		return nullptr;
+	}
+	Ring->Header->Leases[Ring->Reader].store(0);
+	// A producer that restarted between the probe and the claim is caught by the next IsStale
+	Ring->LastPublished = Ring->Header->Published.load();
+	Ring->LastPublishedTime = FPlatformTime::Seconds();
+	UE_LOG(LogVision, Log, TEXT("Frame Ring %s Opened: %d Slots Of %d KB"), *Name, NumSlots, SlotSize / 1024);
+	return Ring;
+}
+
+FFrameRingReader::~FFrameRingReader()
+{
+	// An entry the producer has handed out again after a restart belongs to another reader now
+	if (Header && Reader != INDEX_NONE && Header->Generation.load() == Generation)
+	{
+		Header->Leases[Reader].store(0);
+		Header->Readers[Reader].store(0);
+	}
+	if (Region)
+	{
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(Region);
+	}
+}
+
+bool FFrameRingReader::Acquire(FVisionFrame& Frame, double TimeoutSeconds)
+{
+	Release();
+	const double Start = FPlatformTime::Seconds();
+	for (;;)
+	{
+		const double Now = FPlatformTime::Seconds();
+		const uint64 Published = Header->Published.load();
+		if (Published != LastPublished)
+		{
+			LastPublished = Published;
+			LastPublishedTime = Now;
+		}
+
+		// A restarted producer may have moved the slots and dropped this reader's lease
+		if (HasChanged()) return false;
+		const uint32 Slot = Header->LatestSlot.load();
+		if (Slot < NumSlots)
+		{
+			// The lease is in place before WriteSlot and the header are looked at, see VisionWire.h
+			Header->Leases[Reader].store(Slot + 1);
+			if (Header->WriteSlot.load() != Slot && !HasChanged())
+			{
+				uint8* Data = GetSlot(Slot);
+				const VisionWire::FFrameHeader& Info = *reinterpret_cast<const VisionWire::FFrameHeader*>(Data);
+				if (!bHasFrame || Info.Sequence != LastSequence)
+				{
+					LastSequence = Info.Sequence;
+					bHasFrame = true;
+					const VisionWire::EFrameFormat Format = static_cast<VisionWire::EFrameFormat>(Info.Format);
+					const int32 Channels = Format == VisionWire::EFrameFormat::BGR8 ? 3 : Format == VisionWire::EFrameFormat::BGRA8 ? 4 : 0;
+					const uint64 Bytes = static_cast<uint64>(Info.Width) * Info.Height * Channels;
+					if (Bytes > 0 && VisionWire::RingSlotHeaderSize + Bytes <= SlotSize)
+					{
+						Frame.Image = cv::Mat(Info.Height, Info.Width, CV_8UC(Channels), Data + VisionWire::RingSlotHeaderSize);
+						Frame.Sequence = Info.Sequence;
+						Frame.TimestampUs = Info.TimestampUs;
+						Frame.ReceiveTime = Now;
+						Frame.Stream = Info.Stream;
+						return true;
+					}
+					UE_LOG(LogVision, Verbose, TEXT("Frame Ring Skipped Frame %llu With Format %d Of %d x %d"), Info.Sequence, Info.Format, Info.Width, Info.Height);
+				}
+			}
+			Header->Leases[Reader].store(0);
+		}
+
+		if (Now - Start >= TimeoutSeconds) return false;
+		// No event crosses the process boundary, polling every half millisecond keeps the added latency small
+		FPlatformProcess::SleepNoStats(0.0005f);
+	}
+}
+
+void FFrameRingReader::Release()
+{
+	if (Header->Generation.load() == Generation)
+	{
+		Header->Leases[Reader].store(0);
+	}
+}
+
+bool FFrameRingReader::HasChanged() const
+{
+	return Header->Magic.load() != VisionWire::RingMagic || Header->Generation.load() != Generation
+		|| Header->NumSlots != NumSlots || Header->SlotSize != SlotSize || Header->Readers[Reader].load() != 1;
+}
+
+bool FFrameRingReader::IsStale() const
+{
+	return HasChanged()
+		|| (Header->Published.load() == LastPublished && FPlatformTime::Seconds() - LastPublishedTime > StaleSeconds);
+}
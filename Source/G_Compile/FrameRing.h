@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+#include "FrameIngest.h"
+#include "VisionWire.h"
+
+/*
+ * Reader of a frame ring in shared memory written by another process (see VisionWire.h for the
+ * layout and Tools/VisionFrameProducer.cpp for a producer). Frames are not copied: the image of
+ * an acquired frame is a view of its slot, which the producer leaves alone until the next
+ * Acquire or Release. A crashed or hung capture process only stops the frames, and a restarted
+ * one is picked up again once IsStale asks for the ring to be opened again.
+ */
+class G_COMPILE_API FFrameRingReader
+{
+public:
+	// A ring without new frames for this long counts as abandoned by its producer
+	static constexpr double StaleSeconds = 2.0;
+
+	// Map the ring Name, null while no producer created it
+	static TUniquePtr<FFrameRingReader> Open(const FString& Name);
+	~FFrameRingReader();
+
+	// Wait for a frame newer than the last one taken and hold its slot. Frame.Image views shared memory, it must not be written
+	bool Acquire(FVisionFrame& Frame, double TimeoutSeconds);
+	// Let the producer reuse the slot of the last frame
+	void Release();
+	bool IsStale() const;
+
+private:
+	FFrameRingReader() = default;
+	uint8* GetSlot(uint32 Slot) const { return Base + VisionWire::RingHeaderSize + static_cast<SIZE_T>(Slot) * SlotSize; }
+	// The header is no longer the one this reader opened, e.g. a producer restarted in the same mapping
+	bool HasChanged() const;
+
+	FPlatformMemory::FSharedMemoryRegion* Region = nullptr;
+	uint8* Base = nullptr;
+	VisionWire::FRingHeader* Header = nullptr;
+	// Geometry at open, a producer restarting in the same mapping cannot move the slots under the reader
+	uint32 NumSlots = 0;
+	uint32 SlotSize = 0;
+	uint32 Generation = 0;
+	int32 Reader = INDEX_NONE;
+	uint64 LastSequence = 0;
+	bool bHasFrame = false;
+	uint64 LastPublished = 0;
+	double LastPublishedTime = 0.0;
+};
@@ -2,6 +2,20 @@
 
 #include "G_Compile.h"
 #include "Modules/ModuleManager.h"
+#include "VisionLog.h"
+#include "VisionTimeline.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, G_Compile, "G_Compile" );
+class FG_CompileModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void ShutdownModule() override
+	{
+		// The trace stream and timeline capture threads run module code and read the per-thread buffers,
+		// so they are joined before the module goes away
+		FVisionTrace::Get().StopStreaming();
+		FVisionTimeline::Get().StopCapture();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FG_CompileModule, G_Compile, "G_Compile" );
  
\ No newline at end of file
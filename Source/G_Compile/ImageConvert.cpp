@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ImageConvert.h"
+
+#include "OpenCVLibrary.h"
+#include "opencv2/core/hal/intrin.hpp"
+
+void SwizzleBGRToBGRAScalar(const uint8* Src, int32 SrcPitch, uint8* Dst, int32 DstPitch, int32 Width, int32 Height)
+{
+	for (int32 Row = 0; Row < Height; ++Row, Src += SrcPitch, Dst += DstPitch)
+	{
+		const uint8* In = Src;
+		uint8* Out = Dst;
+		for (int32 Col = 0; Col < Width; ++Col, In += 3, Out += 4)
+		{
+			Out[0] = In[0];
+			Out[1] = In[1];
+			Out[2] = In[2];
+			Out[3] = 255;
+		}
+	}
+}
+
+void SwizzleBGRToBGRA(const uint8* Src, int32 SrcPitch, uint8* Dst, int32 DstPitch, int32 Width, int32 Height)
+{
+	for (int32 Row = 0; Row < Height; ++Row, Src += SrcPitch, Dst += DstPitch)
+	{
+		int32 Col = 0;
+#if CV_SIMD
+		using namespace cv;
+		constexpr int32 Lanes = v_uint8::nlanes;
+		// De-interleave a register of pixels into planes and interleave them again with an alpha plane
+		const v_uint8 Alpha = vx_setall_u8(255);
+		for (; Col + Lanes <= Width; Col += Lanes)
+		{
+			v_uint8 B, G, R;
+			v_load_deinterleave(Src + Col * 3, B, G, R);
+			v_store_interleave(Dst + Col * 4, B, G, R, Alpha);
+		}
+		vx_cleanup();
+#endif
+		const uint8* In = Src + Col * 3;
+		uint8* Out = Dst + Col * 4;
+		for (; Col < Width; ++Col, In += 3, Out += 4)
+		{
+			Out[0] = In[0];
+			Out[1] = In[1];
+			Out[2] = In[2];
+			Out[3] = 255;
+		}
+	}
+}
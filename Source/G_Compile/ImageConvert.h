@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Expand packed BGR rows into BGRA with opaque alpha, in one pass straight into the destination.
+ * Pitches are in bytes, so the destination can be a staging or locked texture buffer with its own
+ * row stride. Channel order is kept, which matches PF_B8G8R8A8.
+ */
+G_COMPILE_API void SwizzleBGRToBGRA(const uint8* Src, int32 SrcPitch, uint8* Dst, int32 DstPitch, int32 Width, int32 Height);
+
+/* Plain per-pixel loop, kept as the reference for SwizzleBGRToBGRA */
+G_COMPILE_API void SwizzleBGRToBGRAScalar(const uint8* Src, int32 SrcPitch, uint8* Dst, int32 DstPitch, int32 Width, int32 Height);
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ModelScheduler.h"
+
+namespace
+{
+	// Length of the window the achieved rate is measured over
+	constexpr double RateWindowSeconds = 1.0;
+	// Weight of the newest sample in the running cost average
+	constexpr float CostSmoothing = 0.1f;
+}
+
+void FModelScheduler::Configure(EVisionModel Model, const FModelSchedule& Schedule)
+{
+	Schedules[Index(Model)] = Schedule;
+}
+
+void FModelScheduler::SetEnabled(EVisionModel Model, bool bEnabled)
+{
+	Schedules[Index(Model)].bEnabled = bEnabled;
+}
+
+int32 FModelScheduler::BeginFrame(double FrameStart, EVisionModel* OutQueue)
+{
+	// A model counts as due half a frame early, so a 30 Hz model on a 30 fps camera does not
+	// slip to every other frame because of capture jitter
+	const double Slack = FrameBudgetMs * 0.5e-3;
+	int32 NumDue = 0;
+	for (int32 i = 0; i < NumModels; ++i)
+	{
+		const FModelSchedule& Schedule = Schedules[i];
+		const double SinceWindowStart = FrameStart - Stats[i].WindowStart;
+		if (Stats[i].WindowStart > 0.0 && SinceWindowStart > 2.0 * RateWindowSeconds)
+		{
+			// The model has stopped running, let the reported rate fall off
+			Stats[i].AchievedHz.store(static_cast<float>(Stats[i].WindowRuns / SinceWindowStart), std::memory_order_relaxed);
+		}
+		if (!Schedule.bEnabled || Schedule.TargetHz <= 0.f) continue;
+		if (FrameStart + Slack < Stats[i].NextDue) continue;
+
+		// Insertion sort by priority, there are only a handful of models
+		int32 Insert = NumDue++;
+		while (Insert > 0 && Schedules[Index(OutQueue[Insert - 1])].Priority < Schedule.Priority)
+		{
+			OutQueue[Insert] = OutQueue[Insert - 1];
+			--Insert;
+		}
+		OutQueue[Insert] = static_cast<EVisionModel>(i);
+	}
+	return NumDue;
+}
+
+bool FModelScheduler::TryRun(EVisionModel Model, double FrameStart, double Now, bool bFirstInFrame)
+{
+	if (bFirstInFrame) return true;
+
+	const FModelSchedule& Schedule = Schedules[Index(Model)];
+	FModelStats& ModelStats = Stats[Index(Model)];
+	const float ExpectedFinishMs = static_cast<float>((Now - FrameStart) * 1000.0) + ModelStats.AvgCostMs.load(std::memory_order_relaxed);
+	if (ExpectedFinishMs > FMath::Min(FrameBudgetMs, Schedule.DeadlineMs))
+	{
+		ModelStats.Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+void FModelScheduler::EndRun(EVisionModel Model, double RunStart, double RunEnd)
+{
+	const FModelSchedule& Schedule = Schedules[Index(Model)];
+	FModelStats& ModelStats = Stats[Index(Model)];
+
+	// Keep a steady cadence, but do not try to catch up on runs missed while disabled or dropped
+	const double Period = 1.0 / Schedule.TargetHz;
+	ModelStats.NextDue = RunStart - ModelStats.NextDue > Period ? RunStart + Period : ModelStats.NextDue + Period;
+
+	const float CostMs = static_cast<float>((RunEnd - RunStart) * 1000.0);
+	const float AvgCostMs = ModelStats.AvgCostMs.load(std::memory_order_relaxed);
+	ModelStats.AvgCostMs.store(AvgCostMs > 0.f ? FMath::Lerp(AvgCostMs, CostMs, CostSmoothing) : CostMs, std::memory_order_relaxed);
+
+	++ModelStats.WindowRuns;
+	const double Elapsed = RunEnd - ModelStats.WindowStart;
+	if (Elapsed >= RateWindowSeconds)
+	{
+		if (ModelStats.WindowStart > 0.0)
+		{
+			ModelStats.AchievedHz.store(static_cast<float>(ModelStats.WindowRuns / Elapsed), std::memory_order_relaxed);
+		}
+		ModelStats.WindowStart = RunEnd;
+		ModelStats.WindowRuns = 0;
+	}
+}
+
+const TCHAR* FModelScheduler::GetModelName(EVisionModel Model)
+{
+	switch (Model)
+	{
+	case EVisionModel::Yolov5Head: return TEXT("Yolov5Head");
+	case EVisionModel::Yolov3Body: return TEXT("Yolov3Body");
+	case EVisionModel::SSDResFace: return TEXT("SSDResFace");
+	default: return TEXT("Unknown");
+	}
+}
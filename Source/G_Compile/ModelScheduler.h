@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+/* Networks that can be scheduled on the reader thread */
+enum class EVisionModel : uint8
+{
+	Yolov5Head,
+	Yolov3Body,
+	SSDResFace,
+	Num
+};
+
+struct FModelSchedule
+{
+	float TargetHz = 30.f;     // Desired run rate of the model
+	int32 Priority = 0;        // Higher runs first, lower is dropped first when over budget
+	float DeadlineMs = 33.3f;  // Latest offset into the frame the model may finish by
+	bool bEnabled = false;
+};
+
+/*
+ * Decides which networks run on a captured frame.
+ * Every model has its own rate, priority and deadline. Due models run in priority order on
+ * the same frame, a model is dropped when its expected cost would overrun the frame budget
+ * or its deadline, and dropped models stay due so they are retried on the next frame.
+ */
+class G_COMPILE_API FModelScheduler
+{
+public:
+	static constexpr int32 NumModels = static_cast<int32>(EVisionModel::Num);
+
+	void Configure(EVisionModel Model, const FModelSchedule& Schedule);
+	void SetEnabled(EVisionModel Model, bool bEnabled);
+	void SetFrameBudget(float InFrameBudgetMs) { FrameBudgetMs = InFrameBudgetMs; }
+
+	// Collect the models due at FrameStart, highest priority first. Returns the number written
+	int32 BeginFrame(double FrameStart, EVisionModel* OutQueue);
+	// Whether a due model still fits into the frame, the first model of a frame always runs
+	bool TryRun(EVisionModel Model, double FrameStart, double Now, bool bFirstInFrame);
+	void EndRun(EVisionModel Model, double RunStart, double RunEnd);
+
+	// Measured rate over the last report window, safe to read from any thread
+	float GetAchievedHz(EVisionModel Model) const { return Stats[Index(Model)].AchievedHz.load(std::memory_order_relaxed); }
+	float GetAverageCostMs(EVisionModel Model) const { return Stats[Index(Model)].AvgCostMs.load(std::memory_order_relaxed); }
+	int32 GetDroppedCount(EVisionModel Model) const { return Stats[Index(Model)].Dropped.load(std::memory_order_relaxed); }
+
+	static const TCHAR* GetModelName(EVisionModel Model);
+
+private:
+	struct FModelStats
+	{
+		double NextDue = 0.0;
+		double WindowStart = 0.0;
+		int32 WindowRuns = 0;
+		std::atomic<float> AchievedHz{ 0.f };
+		std::atomic<float> AvgCostMs{ 0.f };
+		std::atomic<int32> Dropped{ 0 };
+	};
+
+	static int32 Index(EVisionModel Model) { return static_cast<int32>(Model); }
+
+	FModelSchedule Schedules[NumModels];
+	FModelStats Stats[NumModels];
+	float FrameBudgetMs = 33.3f;
+};
@@ -0,0 +1,273 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NMSEngine.h"
+
+#include "OpenCVLibrary.h"
+#include "opencv2/core/hal/intrin.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	// Widest register the corner arrays are padded for (AVX-512)
+	constexpr int32 MaxLanes = 16;
+	// Upper bound of grid cells per axis, keeps the bucket table small for sparse boxes
+	constexpr int32 MaxGridCells = 128;
+}
+
+int32 FNMSEngine::Run(const float* X, const float* Y, const float* Width, const float* Height, const float* Scores, const int32* Classes,
+	int32 Num, const FNMSConfig& Config, TArray<int32>& OutKept, TArray<float>* OutScores)
+{
+	OutKept.Reset();
+	if (OutScores) OutScores->Reset();
+	SortCandidates(X, Y, Width, Height, Scores, Classes, Num, Config);
+	if (Count == 0) return 0;
+
+	if (Config.SoftMode != ESoftNMS::None)
+	{
+		RunSoft(Config, OutKept, OutScores);
+		return OutKept.Num();
+	}
+
+	if (Config.GridMinCandidates > 0 && Count >= Config.GridMinCandidates)
+	{
+		RunGrid(Config, OutKept);
+	}
+	else
+	{
+		RunGreedy(Config, OutKept);
+	}
+	if (OutScores)
+	{
+		for (const int32 Index : OutKept)
+		{
+			OutScores->Add(Scores[Index]);
+		}
+	}
+	return OutKept.Num();
+}
+
+void FNMSEngine::SortCandidates(const float* X, const float* Y, const float* Width, const float* Height, const float* Scores, const int32* Classes,
+	int32 Num, const FNMSConfig& Config)
+{
+	Order.Reset();
+	for (int32 i = 0; i < Num; ++i)
+	{
+		if (Scores[i] > Config.ScoreThreshold) Order.Add(i);
+	}
+
+	// Ties go to the lower index, which gives the same order as the stable sort in NMSBoxes
+	auto Better = [Scores](int32 A, int32 B) { return Scores[A] > Scores[B] || (Scores[A] == Scores[B] && A < B); };
+	if (Config.TopK > 0 && Order.Num() > Config.TopK)
+	{
+		std::nth_element(Order.GetData(), Order.GetData() + Config.TopK, Order.GetData() + Order.Num(), Better);
+		Order.SetNum(Config.TopK, false);
+	}
+	std::sort(Order.GetData(), Order.GetData() + Order.Num(), Better);
+	Count = Order.Num();
+
+	const int32 Padded = Align(Count, MaxLanes);
+	X1.SetNumUninitialized(Padded);
+	Y1.SetNumUninitialized(Padded);
+	X2.SetNumUninitialized(Padded);
+	Y2.SetNumUninitialized(Padded);
+	Area.SetNumUninitialized(Padded);
+	Class.SetNumUninitialized(Padded);
+	Score.SetNumUninitialized(Padded);
+	for (int32 k = 0; k < Count; ++k)
+	{
+		const int32 i = Order[k];
+		X1[k] = X[i];
+		Y1[k] = Y[i];
+		X2[k] = X[i] + Width[i];
+		Y2[k] = Y[i] + Height[i];
+		Area[k] = Width[i] * Height[i];
+		Class[k] = Classes ? static_cast<float>(Classes[i]) : 0.f;
+		Score[k] = Scores[i];
+	}
+	// Padding boxes are empty, so they never overlap anything
+	for (int32 k = Count; k < Padded; ++k)
+	{
+		X1[k] = Y1[k] = X2[k] = Y2[k] = Area[k] = Score[k] = 0.f;
+		Class[k] = -1.f;
+	}
+	Suppressed.SetNumZeroed(FMath::Max(1, Padded / 64 + 1));
+	FMemory::Memzero(Suppressed.GetData(), Suppressed.Num() * sizeof(uint64));
+}
+
+float FNMSEngine::IoU(int32 A, int32 B) const
+{
+	const float W = FMath::Max(0.f, FMath::Min(X2[A], X2[B]) - FMath::Max(X1[A], X1[B]));
+	const float H = FMath::Max(0.f, FMath::Min(Y2[A], Y2[B]) - FMath::Max(Y1[A], Y1[B]));
+	const float Inter = W * H;
+	const float Union = Area[A] + Area[B] - Inter;
+	return Union > 0.f ? Inter / Union : 0.f;
+}
+
+void FNMSEngine::RunGreedy(const FNMSConfig& Config, TArray<int32>& OutKept)
+{
+	const float Threshold = Config.IoUThreshold;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		if (Suppressed[i >> 6] & (1ull << (i & 63))) continue;
+		OutKept.Add(Order[i]);
+
+		int32 j = i + 1;
+#if CV_SIMD
+		using namespace cv;
+		constexpr int32 Lanes = v_float32::nlanes;
+		constexpr uint64 LaneBits = (1ull << Lanes) - 1;
+		const v_float32 BoxX1 = vx_setall_f32(X1[i]);
+		const v_float32 BoxY1 = vx_setall_f32(Y1[i]);
+		const v_float32 BoxX2 = vx_setall_f32(X2[i]);
+		const v_float32 BoxY2 = vx_setall_f32(Y2[i]);
+		const v_float32 BoxArea = vx_setall_f32(Area[i]);
+		const v_float32 BoxClass = vx_setall_f32(Class[i]);
+		const v_float32 Limit = vx_setall_f32(Threshold);
+		const v_float32 Zero = vx_setzero_f32();
+		// Start on a register boundary, rewriting bits of boxes already decided does no harm
+		for (j &= ~(Lanes - 1); j < Count; j += Lanes)
+		{
+			uint64& Word = Suppressed[j >> 6];
+			const int32 Shift = j & 63;
+			if (((Word >> Shift) & LaneBits) == LaneBits) continue;
+
+			const v_float32 W = v_max(v_min(BoxX2, vx_load(&X2[j])) - v_max(BoxX1, vx_load(&X1[j])), Zero);
+			const v_float32 H = v_max(v_min(BoxY2, vx_load(&Y2[j])) - v_max(BoxY1, vx_load(&Y1[j])), Zero);
+			const v_float32 Inter = W * H;
+			// IoU > T without a division: Inter > T * Union
+			v_float32 Overlap = Inter > Limit * (BoxArea + vx_load(&Area[j]) - Inter);
+			if (Config.bClassAware)
+			{
+				Overlap = Overlap & (vx_load(&Class[j]) == BoxClass);
+			}
+			Word |= static_cast<uint64>(static_cast<uint32>(v_signmask(Overlap))) << Shift;
+		}
+		vx_cleanup();
+#endif
+		for (; j < Count; ++j)
+		{
+			if (Config.bClassAware && Class[j] != Class[i]) continue;
+			if (IoU(i, j) > Threshold)
+			{
+				Suppressed[j >> 6] |= 1ull << (j & 63);
+			}
+		}
+	}
+}
+
+void FNMSEngine::RunGrid(const FNMSConfig& Config, TArray<int32>& OutKept)
+{
+	// Cells about twice the mean box size, so a box usually covers no more than four cells
+	float MinX = X1[0], MinY = Y1[0], MaxX = X2[0], MaxY = Y2[0];
+	double SizeSum = 0.0;
+	for (int32 k = 0; k < Count; ++k)
+	{
+		MinX = FMath::Min(MinX, X1[k]);
+		MinY = FMath::Min(MinY, Y1[k]);
+		MaxX = FMath::Max(MaxX, X2[k]);
+		MaxY = FMath::Max(MaxY, Y2[k]);
+		SizeSum += FMath::Max(X2[k] - X1[k], Y2[k] - Y1[k]);
+	}
+	const float Extent = FMath::Max(MaxX - MinX, MaxY - MinY);
+	const float CellSize = FMath::Max3(1.f, static_cast<float>(2.0 * SizeSum / Count), Extent / MaxGridCells);
+	const float InvCell = 1.f / CellSize;
+	const int32 GridX = FMath::Min(MaxGridCells, static_cast<int32>((MaxX - MinX) * InvCell) + 1);
+	const int32 GridY = FMath::Min(MaxGridCells, static_cast<int32>((MaxY - MinY) * InvCell) + 1);
+	auto CellX = [=](float V) { return FMath::Clamp(static_cast<int32>((V - MinX) * InvCell), 0, GridX - 1); };
+	auto CellY = [=](float V) { return FMath::Clamp(static_cast<int32>((V - MinY) * InvCell), 0, GridY - 1); };
+
+	// Count, prefix sum, fill. Boxes go in by score order, so every cell list is ascending
+	CellStart.SetNumZeroed(GridX * GridY + 1);
+	FMemory::Memzero(CellStart.GetData(), CellStart.Num() * sizeof(int32));
+	for (int32 k = 0; k < Count; ++k)
+	{
+		for (int32 Cy = CellY(Y1[k]); Cy <= CellY(Y2[k]); ++Cy)
+			for (int32 Cx = CellX(X1[k]); Cx <= CellX(X2[k]); ++Cx)
+				++CellStart[Cy * GridX + Cx + 1];
+	}
+	for (int32 c = 0; c < GridX * GridY; ++c)
+	{
+		CellStart[c + 1] += CellStart[c];
+	}
+	CellItems.SetNumUninitialized(CellStart[GridX * GridY]);
+	TArray<int32> Fill(CellStart.GetData(), GridX * GridY);
+	for (int32 k = 0; k < Count; ++k)
+	{
+		for (int32 Cy = CellY(Y1[k]); Cy <= CellY(Y2[k]); ++Cy)
+			for (int32 Cx = CellX(X1[k]); Cx <= CellX(X2[k]); ++Cx)
+				CellItems[Fill[Cy * GridX + Cx]++] = k;
+	}
+
+	// Boxes that overlap always share at least one cell
+	const int32* Items = CellItems.GetData();
+	for (int32 i = 0; i < Count; ++i)
+	{
+		if (Suppressed[i >> 6] & (1ull << (i & 63))) continue;
+		OutKept.Add(Order[i]);
+		for (int32 Cy = CellY(Y1[i]); Cy <= CellY(Y2[i]); ++Cy)
+		{
+			for (int32 Cx = CellX(X1[i]); Cx <= CellX(X2[i]); ++Cx)
+			{
+				const int32 Cell = Cy * GridX + Cx;
+				const int32* End = Items + CellStart[Cell + 1];
+				for (const int32* Item = std::upper_bound(Items + CellStart[Cell], End, i); Item != End; ++Item)
+				{
+					const int32 j = *Item;
+					if (Suppressed[j >> 6] & (1ull << (j & 63))) continue;
+					if (Config.bClassAware && Class[j] != Class[i]) continue;
+					if (IoU(i, j) > Config.IoUThreshold)
+					{
+						Suppressed[j >> 6] |= 1ull << (j & 63);
+					}
+				}
+			}
+		}
+	}
+}
+
+void FNMSEngine::RunSoft(const FNMSConfig& Config, TArray<int32>& OutKept, TArray<float>* OutScores)
+{
+	// Live candidates are compacted in place, each round keeps the best and decays the rest
+	TArray<int32> Live;
+	Live.SetNumUninitialized(Count);
+	for (int32 k = 0; k < Count; ++k)
+	{
+		Live[k] = k;
+	}
+	const float InvSigma = 1.f / FMath::Max(Config.SoftSigma, 1e-6f);
+	int32 NumLive = Count;
+	while (NumLive > 0)
+	{
+		int32 BestSlot = 0;
+		for (int32 s = 1; s < NumLive; ++s)
+		{
+			if (Score[Live[s]] > Score[Live[BestSlot]]) BestSlot = s;
+		}
+		const int32 Best = Live[BestSlot];
+		OutKept.Add(Order[Best]);
+		if (OutScores) OutScores->Add(Score[Best]);
+		Live[BestSlot] = Live[--NumLive];
+
+		int32 Write = 0;
+		for (int32 s = 0; s < NumLive; ++s)
+		{
+			const int32 k = Live[s];
+			if (!Config.bClassAware || Class[k] == Class[Best])
+			{
+				const float Overlap = IoU(Best, k);
+				if (Config.SoftMode == ESoftNMS::Gaussian)
+				{
+					Score[k] *= FMath::Exp(-Overlap * Overlap * InvSigma);
+				}
+				else if (Overlap > Config.IoUThreshold)
+				{
+					Score[k] *= 1.f - Overlap;
+				}
+			}
+			if (Score[k] > Config.ScoreThreshold) Live[Write++] = k;
+		}
+		NumLive = Write;
+	}
+}
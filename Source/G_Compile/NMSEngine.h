@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ESoftNMS : uint8
+{
+	None,
+	Linear,     // Score *= 1 - IoU once IoU passes the threshold
+	Gaussian    // Score *= exp(-IoU^2 / Sigma)
+};
+
+struct FNMSConfig
+{
+	float ScoreThreshold = 0.3f;
+	float IoUThreshold = 0.5f;
+	// Only the TopK best candidates take part, 0 keeps all
+	int32 TopK = 0;
+	// Boxes of different classes never suppress each other
+	bool bClassAware = true;
+	ESoftNMS SoftMode = ESoftNMS::None;
+	float SoftSigma = 0.5f;
+	// Candidate count from which hard NMS only compares boxes sharing a grid cell, 0 never does
+	int32 GridMinCandidates = 1000;
+};
+
+/*
+ * Non-maximum suppression over boxes given as separate x, y, width, height arrays.
+ * Candidates above the score threshold are ordered with a top-K partial sort and copied into
+ * padded corner arrays. Hard NMS tests each kept box against a SIMD register of later boxes at
+ * a time and records suppression in a bitmask. For very large candidate counts boxes are binned
+ * into a uniform grid and only boxes sharing a cell are compared. Soft-NMS decays scores
+ * instead of dropping boxes. Scratch buffers are kept between calls, so an engine should stay
+ * on one thread.
+ */
+class G_COMPILE_API FNMSEngine
+{
+public:
+	// Writes kept indices into the input arrays best first, and their scores for Soft-NMS
+	int32 Run(const float* X, const float* Y, const float* Width, const float* Height, const float* Scores, const int32* Classes,
+		int32 Num, const FNMSConfig& Config, TArray<int32>& OutKept, TArray<float>* OutScores = nullptr);
+
+private:
+	void SortCandidates(const float* X, const float* Y, const float* Width, const float* Height, const float* Scores, const int32* Classes,
+		int32 Num, const FNMSConfig& Config);
+	void RunGreedy(const FNMSConfig& Config, TArray<int32>& OutKept);
+	void RunGrid(const FNMSConfig& Config, TArray<int32>& OutKept);
+	void RunSoft(const FNMSConfig& Config, TArray<int32>& OutKept, TArray<float>* OutScores);
+
+	FORCEINLINE float IoU(int32 A, int32 B) const;
+
+	// Candidates in score order, padded to a whole number of SIMD registers
+	int32 Count = 0;
+	TArray<int32> Order;
+	TArray<float> X1, Y1, X2, Y2, Area, Class, Score;
+	TArray<uint64> Suppressed;
+
+	// Grid buckets as a compressed row list of candidate positions
+	TArray<int32> CellStart;
+	TArray<int32> CellItems;
+};
@@ -0,0 +1,248 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ObjectTracker.h"
+
+#include <algorithm>
+
+void FObjectTracker::Configure(const FTrackerConfig& InConfig)
+{
+	Config = InConfig;
+	Config.MaxTracks = FMath::Max(1, Config.MaxTracks);
+	Config.ReferenceHz = FMath::Max(1.f, Config.ReferenceHz);
+	Tracks.Reset(Config.MaxTracks);
+	Matches.Reserve(Config.MaxTracks * 4);
+}
+
+void FObjectTracker::Reset()
+{
+	Tracks.Reset();
+	NextID = 1;
+}
+
+void FObjectTracker::Update(const FDetectionBuffer& Detections, double Time)
+{
+	const uint64 Start = FPlatformTime::Cycles64();
+
+	HighDetections.Reset();
+	LowDetections.Reset();
+	for (int32 i = 0; i < Detections.Count; ++i)
+	{
+		if (Detections.Score[i] > Config.HighThreshold) HighDetections.Add(i);
+		else if (Detections.Score[i] > Config.LowThreshold) LowDetections.Add(i);
+	}
+	DetectionUsed.SetNumZeroed(Detections.Count);
+	FMemory::Memzero(DetectionUsed.GetData(), DetectionUsed.Num() * sizeof(bool));
+
+	for (FTrack& Track : Tracks)
+	{
+		Track.PriorX = Track.Axes[0].Value;
+		Track.PriorY = Track.Axes[1].Value;
+		Track.PriorVelocityX = Track.Axes[0].Velocity;
+		Track.PriorVelocityY = Track.Axes[1].Velocity;
+		Track.PriorTime = Track.Time;
+		Predict(Track, Time);
+		Track.bMatched = false;
+	}
+	PredictionErrorSum = 0.0;
+	HoldErrorSum = 0.0;
+	NumErrors = 0;
+
+	// High score boxes may match any track, low score boxes only keep confirmed tracks alive
+	Associate(Detections, HighDetections, Config.MatchSimilarity, false);
+	Associate(Detections, LowDetections, Config.LowMatchSimilarity, true);
+
+	for (int32 t = Tracks.Num() - 1; t >= 0; --t)
+	{
+		FTrack& Track = Tracks[t];
+		if (Track.bMatched)
+		{
+			Track.bConfirmed |= Track.Hits >= Config.MinHits;
+		}
+		else if (!Track.bConfirmed)
+		{
+			// A tentative track that missed once was most likely a false positive
+			Tracks.RemoveAtSwap(t, 1, false);
+		}
+	}
+
+	for (const int32 i : HighDetections)
+	{
+		if (!DetectionUsed[i] && Detections.Score[i] > Config.NewTrackThreshold)
+		{
+			StartTrack(Detections, i, Time);
+		}
+	}
+	Expire(Time);
+
+	if (NumErrors > 0)
+	{
+		// Smoothed over roughly the last twenty updates
+		const float Alpha = 0.05f;
+		const float Prediction = static_cast<float>(PredictionErrorSum / NumErrors);
+		const float Hold = static_cast<float>(HoldErrorSum / NumErrors);
+		PredictionErrorPx.store(PredictionErrorPx.load(std::memory_order_relaxed) * (1.f - Alpha) + Prediction * Alpha, std::memory_order_relaxed);
+		HoldErrorPx.store(HoldErrorPx.load(std::memory_order_relaxed) * (1.f - Alpha) + Hold * Alpha, std::memory_order_relaxed);
+	}
+
+	LastCostUs.store(static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0), std::memory_order_relaxed);
+}
+
+void FObjectTracker::Expire(double Time)
+{
+	for (int32 t = Tracks.Num() - 1; t >= 0; --t)
+	{
+		if (Time - Tracks[t].LastSeen > Config.MaxCoastSeconds)
+		{
+			Tracks.RemoveAtSwap(t, 1, false);
+		}
+	}
+}
+
+int32 FObjectTracker::WriteTracks(double Time, FDetectionBuffer& Out) const
+{
+	Out.Reset();
+	for (const FTrack& Track : Tracks)
+	{
+		if (!Track.bConfirmed) continue;
+		const float Dt = static_cast<float>(Time - Track.Time);
+		const float CenterX = Track.Axes[0].Value + Track.Axes[0].Velocity * Dt;
+		const float CenterY = Track.Axes[1].Value + Track.Axes[1].Velocity * Dt;
+		const float Width = FMath::Max(1.f, Track.Axes[2].Value + Track.Axes[2].Velocity * Dt);
+		const float Height = FMath::Max(1.f, Track.Axes[3].Value + Track.Axes[3].Velocity * Dt);
+		if (!Out.Add(CenterX - 0.5f * Width, CenterY - 0.5f * Height, Width, Height, CenterX, CenterY, Track.Score, Track.ClassID,
+			Track.ID, Track.Axes[0].Velocity, Track.Axes[1].Velocity)) break;
+	}
+	return Out.Count;
+}
+
+void FObjectTracker::Predict(FTrack& Track, double Time) const
+{
+	const float Dt = FMath::Max(0.f, static_cast<float>(Time - Track.Time));
+	if (Dt <= 0.f) return;
+	// Noise grows with the number of reference frames elapsed, velocity noise is per frame converted to per second
+	const float Steps = Dt * Config.ReferenceHz;
+	for (int32 a = 0; a < 4; ++a)
+	{
+		FAxis& Axis = Track.Axes[a];
+		const float Size = Track.Axes[a & 1 ? 3 : 2].Value;
+		const float PositionStd = Config.PositionWeight * Size;
+		const float VelocityStd = Config.VelocityWeight * Size * Config.ReferenceHz;
+		Axis.Value += Axis.Velocity * Dt;
+		Axis.P00 += Dt * (2.f * Axis.P01 + Dt * Axis.P11) + PositionStd * PositionStd * Steps;
+		Axis.P01 += Dt * Axis.P11;
+		Axis.P11 += VelocityStd * VelocityStd * Steps;
+	}
+	Track.Time = Time;
+}
+
+void FObjectTracker::Correct(FTrack& Track, const FDetectionBuffer& Detections, int32 Index, double Time)
+{
+	const float Measured[4] = {
+		Detections.X[Index] + 0.5f * Detections.Width[Index],
+		Detections.Y[Index] + 0.5f * Detections.Height[Index],
+		Detections.Width[Index],
+		Detections.Height[Index] };
+
+	// Where the game put this target when extrapolating the previous result, against where it really is
+	if (Track.bConfirmed)
+	{
+		const float Lead = FMath::Clamp(static_cast<float>(Time - Track.PriorTime), 0.f, Config.PredictionHorizon);
+		PredictionErrorSum += FMath::Sqrt(FMath::Square(Measured[0] - Track.PriorX - Track.PriorVelocityX * Lead)
+			+ FMath::Square(Measured[1] - Track.PriorY - Track.PriorVelocityY * Lead));
+		HoldErrorSum += FMath::Sqrt(FMath::Square(Measured[0] - Track.PriorX) + FMath::Square(Measured[1] - Track.PriorY));
+		++NumErrors;
+	}
+
+	for (int32 a = 0; a < 4; ++a)
+	{
+		FAxis& Axis = Track.Axes[a];
+		const float MeasureStd = Config.PositionWeight * Track.Axes[a & 1 ? 3 : 2].Value;
+		const float Innovation = Measured[a] - Axis.Value;
+		const float S = Axis.P00 + MeasureStd * MeasureStd;
+		const float K0 = Axis.P00 / S;
+		const float K1 = Axis.P01 / S;
+		Axis.Value += K0 * Innovation;
+		Axis.Velocity += K1 * Innovation;
+		Axis.P11 -= K1 * Axis.P01;
+		Axis.P00 *= 1.f - K0;
+		Axis.P01 *= 1.f - K0;
+	}
+	Track.Score = Detections.Score[Index];
+	Track.LastSeen = Time;
+	Track.bMatched = true;
+	++Track.Hits;
+}
+
+void FObjectTracker::StartTrack(const FDetectionBuffer& Detections, int32 Index, double Time)
+{
+	if (Tracks.Num() >= Config.MaxTracks) return;
+	FTrack& Track = Tracks.AddDefaulted_GetRef();
+	const float Measured[4] = {
+		Detections.X[Index] + 0.5f * Detections.Width[Index],
+		Detections.Y[Index] + 0.5f * Detections.Height[Index],
+		Detections.Width[Index],
+		Detections.Height[Index] };
+	for (int32 a = 0; a < 4; ++a)
+	{
+		// Velocity starts unknown, so its variance is large
+		const float Size = Measured[a & 1 ? 3 : 2];
+		const float PositionStd = 2.f * Config.PositionWeight * Size;
+		const float VelocityStd = 10.f * Config.VelocityWeight * Size * Config.ReferenceHz;
+		Track.Axes[a].Value = Measured[a];
+		Track.Axes[a].P00 = PositionStd * PositionStd;
+		Track.Axes[a].P11 = VelocityStd * VelocityStd;
+	}
+	Track.ID = NextID++;
+	Track.ClassID = Detections.ClassID[Index];
+	Track.Score = Detections.Score[Index];
+	Track.Time = Time;
+	Track.LastSeen = Time;
+	Track.Hits = 1;
+	Track.bConfirmed = Config.MinHits <= 1;
+	Track.bMatched = true;
+}
+
+float FObjectTracker::Similarity(const FTrack& Track, const FDetectionBuffer& Detections, int32 Index) const
+{
+	const float TrackW = Track.Axes[2].Value, TrackH = Track.Axes[3].Value;
+	const float TrackX = Track.Axes[0].Value - 0.5f * TrackW, TrackY = Track.Axes[1].Value - 0.5f * TrackH;
+	const float X = Detections.X[Index], Y = Detections.Y[Index], W = Detections.Width[Index], H = Detections.Height[Index];
+
+	const float InterW = FMath::Max(0.f, FMath::Min(TrackX + TrackW, X + W) - FMath::Max(TrackX, X));
+	const float InterH = FMath::Max(0.f, FMath::Min(TrackY + TrackH, Y + H) - FMath::Max(TrackY, Y));
+	const float Inter = InterW * InterH;
+	const float Union = TrackW * TrackH + W * H - Inter;
+	const float IoU = Union > 0.f ? Inter / Union : 0.f;
+
+	// Fast or rarely sampled targets can leave their predicted box, compare centres relative to the box size
+	const float Dx = Track.Axes[0].Value - (X + 0.5f * W);
+	const float Dy = Track.Axes[1].Value - (Y + 0.5f * H);
+	const float Gate = Config.CentroidGate * FMath::Max(TrackW, TrackH);
+	const float Centroid = Gate > 0.f ? Config.CentroidWeight * (1.f - FMath::Sqrt(Dx * Dx + Dy * Dy) / Gate) : 0.f;
+	return FMath::Max(IoU, Centroid);
+}
+
+void FObjectTracker::Associate(const FDetectionBuffer& Detections, const TArray<int32>& Candidates, float MinSimilarity, bool bConfirmedOnly)
+{
+	Matches.Reset();
+	for (int32 t = 0; t < Tracks.Num(); ++t)
+	{
+		const FTrack& Track = Tracks[t];
+		if (Track.bMatched || (bConfirmedOnly && !Track.bConfirmed)) continue;
+		for (const int32 i : Candidates)
+		{
+			if (DetectionUsed[i] || Detections.ClassID[i] != Track.ClassID) continue;
+			const float Value = Similarity(Track, Detections, i);
+			if (Value >= MinSimilarity) Matches.Add({ Value, t, i });
+		}
+	}
+	std::sort(Matches.GetData(), Matches.GetData() + Matches.Num(), [](const FMatch& A, const FMatch& B) { return A.Similarity > B.Similarity; });
+	for (const FMatch& Match : Matches)
+	{
+		FTrack& Track = Tracks[Match.Track];
+		if (Track.bMatched || DetectionUsed[Match.Detection]) continue;
+		Correct(Track, Detections, Match.Detection, Track.Time);
+		DetectionUsed[Match.Detection] = true;
+	}
+}
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DetectionBuffer.h"
+
+#include <atomic>
+
+struct FTrackerConfig
+{
+	// Detections above HighThreshold are matched first, the ones down to LowThreshold only extend existing tracks
+	float HighThreshold = 0.5f;
+	float LowThreshold = 0.1f;
+	// Unmatched detections above this start a new track
+	float NewTrackThreshold = 0.6f;
+	// Least similarity for a match in the high and the low pass
+	float MatchSimilarity = 0.2f;
+	float LowMatchSimilarity = 0.5f;
+	// Boxes that do not overlap still match when their centres are closer than this many box sizes
+	float CentroidGate = 1.5f;
+	float CentroidWeight = 0.5f;
+	// Matches needed before a track is reported, and how long a reported track coasts without one
+	int32 MinHits = 2;
+	float MaxCoastSeconds = 1.f;
+	// Noise of the motion model relative to the box size, per frame at ReferenceHz
+	float PositionWeight = 1.f / 20.f;
+	float VelocityWeight = 1.f / 160.f;
+	float ReferenceHz = 30.f;
+	int32 MaxTracks = 256;
+	// Longest time the output is extrapolated ahead of the last result, used for the prediction error
+	float PredictionHorizon = 0.1f;
+};
+
+/*
+ * Multi-object tracker run on the NMS output of every inference.
+ * Each track holds a constant velocity Kalman filter over box centre and size. With noise that
+ * is independent per coordinate the filter splits exactly into four [position, velocity]
+ * filters with 2x2 covariances, which is what is stored. Association follows ByteTrack: tracks
+ * are greedily matched to high score detections by IoU, falling back to centre distance for
+ * boxes that moved clear of their prediction, and tracks still unmatched get a second pass
+ * against the low score detections. Tracks keep their ID while they coast, so inference can run
+ * slower than the camera. Time is in seconds and velocities in pixels per second.
+ */
+class G_COMPILE_API FObjectTracker
+{
+public:
+	void Configure(const FTrackerConfig& InConfig);
+	void Reset();
+
+	// Advance all tracks to Time and match them with the detections of that frame
+	void Update(const FDetectionBuffer& Detections, double Time);
+	// Drop tracks that coasted too long, for frames without inference
+	void Expire(double Time);
+
+	// Write the reported tracks extrapolated to Time with their velocity, CenterX and CenterY are in frame pixels
+	int32 WriteTracks(double Time, FDetectionBuffer& Out) const;
+
+	int32 NumTracks() const { return Tracks.Num(); }
+	// Cost of the last Update, safe to read from any thread
+	float GetLastCostUs() const { return LastCostUs.load(std::memory_order_relaxed); }
+	// Running mean distance of matched detections from the previous result extrapolated over the
+	// prediction horizon, and from the previous result held in place, in pixels
+	float GetPredictionErrorPx() const { return PredictionErrorPx.load(std::memory_order_relaxed); }
+	float GetHoldErrorPx() const { return HoldErrorPx.load(std::memory_order_relaxed); }
+
+private:
+	// Position, velocity and covariance of one coordinate
+	struct FAxis
+	{
+		float Value = 0.f;
+		float Velocity = 0.f;
+		float P00 = 0.f, P01 = 0.f, P11 = 0.f;
+	};
+
+	struct FTrack
+	{
+		// Centre x, centre y, width, height
+		FAxis Axes[4];
+		// Centre and velocity as last reported, before this update's prediction
+		float PriorX = 0.f, PriorY = 0.f, PriorVelocityX = 0.f, PriorVelocityY = 0.f;
+		double PriorTime = 0.0;
+		double Time = 0.0;
+		double LastSeen = 0.0;
+		int32 ID = 0;
+		int32 ClassID = 0;
+		int32 Hits = 0;
+		float Score = 0.f;
+		bool bConfirmed = false;
+		bool bMatched = false;
+	};
+
+	struct FMatch
+	{
+		float Similarity;
+		int32 Track;
+		int32 Detection;
+	};
+
+	void Predict(FTrack& Track, double Time) const;
+	void Correct(FTrack& Track, const FDetectionBuffer& Detections, int32 Index, double Time);
+	void StartTrack(const FDetectionBuffer& Detections, int32 Index, double Time);
+	float Similarity(const FTrack& Track, const FDetectionBuffer& Detections, int32 Index) const;
+	// Greedy best-first assignment of unmatched tracks to the listed detections
+	void Associate(const FDetectionBuffer& Detections, const TArray<int32>& Candidates, float MinSimilarity, bool bConfirmedOnly);
+
+	FTrackerConfig Config;
+	TArray<FTrack> Tracks;
+	int32 NextID = 1;
+
+	// Scratch kept between updates
+	TArray<int32> HighDetections;
+	TArray<int32> LowDetections;
+	TArray<bool> DetectionUsed;
+	TArray<FMatch> Matches;
+	double PredictionErrorSum = 0.0;
+	double HoldErrorSum = 0.0;
+	int32 NumErrors = 0;
+
+	std::atomic<float> LastCostUs{ 0.f };
+	std::atomic<float> PredictionErrorPx{ 0.f };
+	std::atomic<float> HoldErrorPx{ 0.f };
+};
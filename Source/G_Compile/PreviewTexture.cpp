@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PreviewTexture.h"
+#include "RenderingThread.h"
+#include "ImageConvert.h"
+
+FPreviewTexture::~FPreviewTexture()
+{
+	// Pending region updates still read the staging buffers
+	FlushRenderingCommands();
+}
+
+int32 FPreviewTexture::AcquireStaging(int32 Width, int32 Height)
+{
+	for (int32 Slot = 0; Slot < NumStaging; ++Slot)
+	{
+		FStaging& Buffer = Staging[Slot];
+		bool bExpected = false;
+		if (!Buffer.bBusy.compare_exchange_strong(bExpected, true, std::memory_order_acquire)) continue;
+
+		// Only grows on a resolution change, the same buffer is reused for every frame after that
+		Buffer.Data.SetNumUninitialized(Width * Height * 4, false);
+		Buffer.Region = FUpdateTextureRegion2D(0, 0, 0, 0, Width, Height);
+		return Slot;
+	}
+	DroppedCount.fetch_add(1, std::memory_order_relaxed);
+	return INDEX_NONE;
+}
+
+UTexture2D* FPreviewTexture::Submit(int32 Slot, UTexture2D*& Texture)
+{
+	const uint64 Start = FPlatformTime::Cycles64();
+	FStaging& Buffer = Staging[Slot];
+	const int32 Width = Buffer.Region.Width;
+	const int32 Height = Buffer.Region.Height;
+	if (!Texture || Texture->GetSizeX() != Width || Texture->GetSizeY() != Height)
+	{
+		Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
+		Texture->SRGB = 0;
+		Texture->UpdateResource();
+		++CreatedCount;
+	}
+
+	// The render thread copies the buffer into the texture and then hands it back to the pool
+	std::atomic<bool>* Busy = &Buffer.bBusy;
+	Texture->UpdateTextureRegions(0, 1, &Buffer.Region, Width * 4, 4, Buffer.Data.GetData(),
+		[Busy](uint8*, const FUpdateTextureRegion2D*) { Busy->store(false, std::memory_order_release); });
+
+	RecordSubmit(Start);
+	return Texture;
+}
+
+UTexture2D* FPreviewTexture::SubmitTransient(const uint8* Bgr, int32 Pitch, int32 Width, int32 Height)
+{
+	const uint64 Start = FPlatformTime::Cycles64();
+	// A fresh converted copy, a new texture and its bulk data every frame, as ConvertMat2Texture2D did
+	TArray<uint8> Bgra;
+	Bgra.SetNumUninitialized(Width * Height * 4);
+	SwizzleBGRToBGRA(Bgr, Pitch, Bgra.GetData(), Width * 4, Width, Height);
+	UTexture2D* Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
+	Texture->SRGB = 0;
+	void* TextureData = Texture->PlatformData->Mips[0].BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memmove(TextureData, Bgra.GetData(), Bgra.Num());
+	Texture->PlatformData->Mips[0].BulkData.Unlock();
+	Texture->UpdateResource();
+	++CreatedCount;
+	RecordSubmit(Start);
+	return Texture;
+}
+
+void FPreviewTexture::RecordSubmit(uint64 Start)
+{
+	const float Us = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0);
+	SubmitUs = SubmitUs > 0.f ? SubmitUs * 0.95f + Us * 0.05f : Us;
+}
+
+int32 FPreviewTexture::GetInFlight() const
+{
+	int32 InFlight = 0;
+	for (const FStaging& Buffer : Staging)
+	{
+		InFlight += Buffer.bBusy.load(std::memory_order_relaxed) ? 1 : 0;
+	}
+	return InFlight;
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture2D.h"
+
+#include <atomic>
+
+/*
+ * One persistent BGRA texture fed from a worker thread.
+ * The worker fills one of a few staging buffers and the game thread submits it, which queues
+ * a region update of the existing texture on the render thread. The staging buffer goes back to
+ * the pool once the render thread has copied it, and a frame is dropped when every buffer is
+ * still in flight. The texture is only created again when the frame size changes, and is held by
+ * the owner (a UPROPERTY) so the garbage collector sees it.
+ */
+class G_COMPILE_API FPreviewTexture
+{
+public:
+	static constexpr int32 NumStaging = 3;
+
+	~FPreviewTexture();
+
+	// Worker thread: claim a free staging buffer for a Width x Height frame, INDEX_NONE when all are in flight
+	int32 AcquireStaging(int32 Width, int32 Height);
+	uint8* GetStagingData(int32 Slot) { return Staging[Slot].Data.GetData(); }
+	int32 GetStagingPitch(int32 Slot) const { return Staging[Slot].Region.Width * 4; }
+
+	// Game thread: upload a filled staging buffer into Texture, which is created again on a size change
+	UTexture2D* Submit(int32 Slot, UTexture2D*& Texture);
+	// Game thread: the path this replaced, a new transient texture per frame converted and copied here.
+	// Kept to measure both with the same counters
+	UTexture2D* SubmitTransient(const uint8* Bgr, int32 Pitch, int32 Width, int32 Height);
+
+	// Game thread cost of the last submits, textures created and frames dropped so far
+	float GetSubmitUs() const { return SubmitUs; }
+	int32 GetCreatedCount() const { return CreatedCount; }
+	int32 GetDroppedCount() const { return DroppedCount.load(std::memory_order_relaxed); }
+	// Staging buffers being filled or waiting for the render thread
+	int32 GetInFlight() const;
+
+private:
+	struct FStaging
+	{
+		TArray<uint8> Data;
+		FUpdateTextureRegion2D Region;
+		std::atomic<bool> bBusy{ false };
+	};
+
+	void RecordSubmit(uint64 Start);
+
+	FStaging Staging[NumStaging];
+	float SubmitUs = 0.f;
+	int32 CreatedCount = 0;
+	std::atomic<int32> DroppedCount{ 0 };
+};
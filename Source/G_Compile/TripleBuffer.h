@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+/*
+ * Single producer, single consumer triple buffer.
+ * The producer fills GetWriteBuffer and Publishes it, the consumer Acquires and then Reads the
+ * most recent published slot. Publish and Acquire are each a single atomic exchange of the
+ * shared slot index, so neither side ever waits and the reader never sees a half written value.
+ * Slots are default constructed once and reused, so preallocate them through ForEachSlot.
+ */
+template<typename ElementType>
+class TLockFreeTripleBuffer
+{
+public:
+	// Producer side
+	ElementType& GetWriteBuffer() { return Slots[WriteIndex]; }
+	void Publish()
+	{
+		WriteIndex = Shared.exchange(WriteIndex | DirtyBit, std::memory_order_acq_rel) & IndexMask;
+	}
+
+	// Consumer side, returns false when nothing new was published since the last Acquire
+	bool Acquire()
+	{
+		if (!(Shared.load(std::memory_order_relaxed) & DirtyBit)) return false;
+		ReadIndex = Shared.exchange(ReadIndex, std::memory_order_acq_rel) & IndexMask;
+		return true;
+	}
+	const ElementType& Read() const { return Slots[ReadIndex]; }
+
+	// Setup only, before either side runs
+	template<typename FunctorType>
+	void ForEachSlot(FunctorType&& Functor)
+	{
+		for (ElementType& Slot : Slots) Functor(Slot);
+	}
+
+private:
+	static constexpr uint32 IndexMask = 3;
+	static constexpr uint32 DirtyBit = 4;
+
+	ElementType Slots[3];
+	std::atomic<uint32> Shared{ 1 };
+	uint32 WriteIndex = 0;
+	uint32 ReadIndex = 2;
+};
@@ -0,0 +1,711 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Micro-benchmarks for the vision hot path, run from the console:
+ *   CV.Bench.Objectness [Iterations]
+ *   CV.Bench.NMS [Iterations]
+ *   CV.Bench.Tracker [Frames]
+ *   CV.Bench.Swizzle [Iterations]
+ *   CV.Bench.Ingest [Streams] [Seconds] [jpeg|bgr]
+ *   CV.Bench.Suite [-image=Frame.png] [-baseline=Path] [-save] [-seconds=0.1] [-threshold=0.1]
+ *
+ * The suite compares with Config/VisionBenchBaseline.json when it exists. None is committed, as
+ * ns/op only compares on one machine, so the first run on a machine creates it with -save.
+ */
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "IPAddress.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+#include "OpenCVLibrary.h"
+#include "YoloDecoder.h"
+#include "NMSEngine.h"
+#include "ObjectTracker.h"
+#include "ImageConvert.h"
+#include "CVProcessor.h"
+#include "FrameIngest.h"
+#include "VisionLatency.h"
+#include "VisionLog.h"
+
+namespace
+{
+	// Fill a [NumRows, RowLength] proposal matrix where HitRate of the rows pass Threshold
+	void MakeProposals(TArray<float>& Data, int32 NumRows, int32 RowLength, float HitRate, float Threshold, int32 Seed)
+	{
+		FRandomStream Random(Seed);
+		Data.SetNumUninitialized(NumRows * RowLength);
+		for (int32 Row = 0; Row < NumRows; ++Row)
+		{
+			float* Prediction = Data.GetData() + Row * RowLength;
+			for (int32 Col = 0; Col < RowLength; ++Col)
+			{
+				Prediction[Col] = Random.FRand();
+			}
+			Prediction[4] = Random.FRand() < HitRate ? Random.FRandRange(Threshold + 0.01f, 1.f) : Random.FRandRange(0.f, Threshold * 0.9f);
+		}
+	}
+
+	void BenchObjectness(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 200;
+		const int32 NumRows = 25200;
+		const float Threshold = 0.3f;
+		const int32 RowLengths[] = { 6, 85 };
+		const float HitRates[] = { 0.001f, 0.005f, 0.01f, 0.02f };
+
+		TArray<float> Data;
+		TArray<int32> Indices;
+		Indices.SetNumUninitialized(NumRows);
+		for (const int32 RowLength : RowLengths)
+		{
+			for (const float HitRate : HitRates)
+			{
+				MakeProposals(Data, NumRows, RowLength, HitRate, Threshold, 1234);
+
+				int32 ScalarKept = 0;
+				uint64 Start = FPlatformTime::Cycles64();
+				for (int32 i = 0; i < Iterations; ++i)
+				{
+					ScalarKept = FilterObjectnessScalar(Data.GetData(), NumRows, RowLength, 4, Threshold, Indices.GetData());
+				}
+				const double ScalarUs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0 / Iterations;
+
+				int32 SimdKept = 0;
+				Start = FPlatformTime::Cycles64();
+				for (int32 i = 0; i < Iterations; ++i)
+				{
+					SimdKept = FilterObjectness(Data.GetData(), NumRows, RowLength, 4, Threshold, Indices.GetData());
+				}
+				const double SimdUs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0 / Iterations;
+
+				UE_LOG(LogVision, Display, TEXT("Objectness %d x %d, hit %.1f%%: scalar %.2f us, simd %.2f us, x%.2f, kept %d/%d%s"),
+					NumRows, RowLength, HitRate * 100.f, ScalarUs, SimdUs, SimdUs > 0.0 ? ScalarUs / SimdUs : 0.0,
+					SimdKept, ScalarKept, SimdKept == ScalarKept ? TEXT("") : TEXT(" MISMATCH"));
+			}
+		}
+	}
+
+	// Candidates clustered around a few targets, the way a crowded frame decodes
+	void MakeCandidates(std::vector<cv::Rect>& Boxes, std::vector<float>& Scores, int32 Num, int32 Seed)
+	{
+		FRandomStream Random(Seed);
+		const int32 NumTargets = FMath::Max(1, Num / 10);
+		Boxes.clear();
+		Scores.clear();
+		for (int32 i = 0; i < Num; ++i)
+		{
+			FRandomStream Target(Seed + i % NumTargets);
+			const int32 Size = Target.RandRange(30, 120);
+			Boxes.push_back(cv::Rect(Target.RandRange(0, 1800) + Random.RandRange(-8, 8), Target.RandRange(0, 960) + Random.RandRange(-8, 8),
+				Size + Random.RandRange(-6, 6), Size + Random.RandRange(-6, 6)));
+			Scores.push_back(Random.FRandRange(0.31f, 1.f));
+		}
+	}
+
+	void BenchNMS(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100;
+		const int32 Counts[] = { 50, 500, 5000 };
+
+		std::vector<cv::Rect> Boxes;
+		std::vector<float> Scores;
+		std::vector<int> Indices;
+		TArray<float> X, Y, Width, Height;
+		TArray<int32> Classes, Kept;
+		FNMSEngine Engine;
+		for (const int32 Num : Counts)
+		{
+			MakeCandidates(Boxes, Scores, Num, 99);
+			X.SetNumUninitialized(Num);
+			Y.SetNumUninitialized(Num);
+			Width.SetNumUninitialized(Num);
+			Height.SetNumUninitialized(Num);
+			Classes.SetNumZeroed(Num);
+			for (int32 i = 0; i < Num; ++i)
+			{
+				X[i] = static_cast<float>(Boxes[i].x);
+				Y[i] = static_cast<float>(Boxes[i].y);
+				Width[i] = static_cast<float>(Boxes[i].width);
+				Height[i] = static_cast<float>(Boxes[i].height);
+			}
+			const int32 NumIterations = FMath::Max(1, Iterations * 50 / Num);
+
+			uint64 Start = FPlatformTime::Cycles64();
+			for (int32 i = 0; i < NumIterations; ++i)
+			{
+				cv::dnn::NMSBoxes(Boxes, Scores, 0.3f, 0.5f, Indices);
+			}
+			const double BaselineUs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0 / NumIterations;
+
+			auto TimeEngine = [&](const FNMSConfig& Config)
+			{
+				const uint64 EngineStart = FPlatformTime::Cycles64();
+				for (int32 i = 0; i < NumIterations; ++i)
+				{
+					Engine.Run(X.GetData(), Y.GetData(), Width.GetData(), Height.GetData(), Scores.data(), Classes.GetData(), Num, Config, Kept);
+				}
+				return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - EngineStart) * 1000.0 / NumIterations;
+			};
+			FNMSConfig Config;
+			Config.GridMinCandidates = 0;
+			const double GreedyUs = TimeEngine(Config);
+			const int32 GreedyKept = Kept.Num();
+			Config.GridMinCandidates = 1;
+			const double GridUs = TimeEngine(Config);
+			const int32 GridKept = Kept.Num();
+			Config.SoftMode = ESoftNMS::Gaussian;
+			const double SoftUs = TimeEngine(Config);
+
+			UE_LOG(LogVision, Display, TEXT("NMS %d boxes: NMSBoxes %.2f us (%d kept), greedy %.2f us (%d), grid %.2f us (%d), soft %.2f us"),
+				Num, BaselineUs, static_cast<int32>(Indices.size()), GreedyUs, GreedyKept, GridUs, GridKept, SoftUs);
+		}
+	}
+
+	// Targets moving at constant velocity with jittered boxes, every fourth frame a target only shows as a low score box
+	void BenchTracker(const TArray<FString>& Args)
+	{
+		const int32 Frames = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 300;
+		const int32 Counts[] = { 10, 40, 100 };
+		const double FrameSeconds = 1.0 / 15.0;
+
+		FDetectionBuffer Detections;
+		FDetectionBuffer Tracks;
+		Detections.Reserve(256);
+		Tracks.Reserve(256);
+		for (const int32 Num : Counts)
+		{
+			FRandomStream Random(7);
+			TArray<FVector4> Targets;
+			for (int32 i = 0; i < Num; ++i)
+			{
+				Targets.Add(FVector4(Random.FRandRange(0.f, 1800.f), Random.FRandRange(0.f, 960.f), Random.FRandRange(-150.f, 150.f), Random.FRandRange(-100.f, 100.f)));
+			}
+
+			FObjectTracker Tracker;
+			Tracker.Configure(FTrackerConfig());
+			double TotalUs = 0.0;
+			float MaxUs = 0.f;
+			for (int32 Frame = 0; Frame < Frames; ++Frame)
+			{
+				const double Time = Frame * FrameSeconds;
+				Detections.Reset();
+				for (int32 i = 0; i < Num; ++i)
+				{
+					const float CenterX = Targets[i].X + Targets[i].Z * Time;
+					const float CenterY = Targets[i].Y + Targets[i].W * Time;
+					const float Score = (Frame + i) % 4 == 0 ? 0.3f : 0.9f;
+					Detections.Add(CenterX - 20.f + Random.FRandRange(-2.f, 2.f), CenterY - 25.f + Random.FRandRange(-2.f, 2.f), 40.f, 50.f, CenterX, CenterY, Score, 0);
+				}
+				Tracker.Update(Detections, Time);
+				TotalUs += Tracker.GetLastCostUs();
+				MaxUs = FMath::Max(MaxUs, Tracker.GetLastCostUs());
+			}
+			Tracker.WriteTracks(Frames * FrameSeconds, Tracks);
+			UE_LOG(LogVision, Display, TEXT("Tracker %d targets: %.2f us avg, %.2f us max, %d tracks, %d reported"),
+				Num, TotalUs / Frames, MaxUs, Tracker.NumTracks(), Tracks.Count);
+		}
+	}
+
+	// Bytes read plus written per frame, so the numbers compare with the memory bandwidth of the machine
+	void BenchSwizzle(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100;
+		const int32 Width = 1920;
+		const int32 Height = 1080;
+		cv::Mat Frame(Height, Width, CV_8UC3);
+		cv::randu(Frame, cv::Scalar::all(0), cv::Scalar::all(255));
+		TArray<uint8> Upload;
+		Upload.SetNumUninitialized(Width * Height * 4);
+		cv::Mat UploadMat(Height, Width, CV_8UC4, Upload.GetData());
+		const double FrameBytes = Width * Height * 7.0;
+
+		auto Time = [&](auto&& Convert)
+		{
+			const uint64 Start = FPlatformTime::Cycles64();
+			for (int32 i = 0; i < Iterations; ++i)
+			{
+				Convert();
+			}
+			const double Ms = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) / Iterations;
+			UE_LOG(LogVision, Display, TEXT("    %.3f ms, %.2f GB/s"), Ms, FrameBytes / (Ms * 1e6));
+		};
+
+		UE_LOG(LogVision, Display, TEXT("Swizzle %d x %d BGR to BGRA:"), Width, Height);
+		UE_LOG(LogVision, Display, TEXT("  cvtColor to a temporary, then memcpy to the upload buffer"));
+		cv::Mat Temporary;
+		Time([&]()
+		{
+			cv::cvtColor(Frame, Temporary, cv::COLOR_BGR2BGRA);
+			FMemory::Memcpy(Upload.GetData(), Temporary.data, Upload.Num());
+		});
+		UE_LOG(LogVision, Display, TEXT("  cvtColor into the upload buffer"));
+		Time([&]() { cv::cvtColor(Frame, UploadMat, cv::COLOR_BGR2BGRA); });
+		UE_LOG(LogVision, Display, TEXT("  Scalar swizzle"));
+		Time([&]() { SwizzleBGRToBGRAScalar(Frame.ptr(), static_cast<int32>(Frame.step), Upload.GetData(), Width * 4, Width, Height); });
+		UE_LOG(LogVision, Display, TEXT("  SIMD swizzle"));
+		Time([&]() { SwizzleBGRToBGRA(Frame.ptr(), static_cast<int32>(Frame.step), Upload.GetData(), Width * 4, Width, Height); });
+	}
+
+	bool SendAll(FSocket* Socket, const uint8* Data, int32 Size)
+	{
+		while (Size > 0)
+		{
+			int32 Sent = 0;
+			if (!Socket->Send(Data, Size, Sent) || Sent <= 0) return false;
+			Data += Sent;
+			Size -= Sent;
+		}
+		return true;
+	}
+
+	// Loopback senders and readers around a real FFrameIngestServer, so sockets, decode and hand over are all counted
+	void RunIngestBench(int32 Streams, double Seconds, bool bRaw)
+	{
+		const int32 Port = 9099;
+		const int32 Width = 1920;
+		const int32 Height = 1080;
+		const double FrameSeconds = 1.0 / 30.0;
+		TSharedPtr<FFrameIngestServer> Server = FFrameIngestServer::Acquire(Port, 4);
+		if (!Server) return;
+
+		// Smooth noise compresses about like a camera image, pure noise would make JPEG unrealistically slow
+		cv::Mat Small(Height / 8, Width / 8, CV_8UC3);
+		cv::randu(Small, cv::Scalar::all(0), cv::Scalar::all(255));
+		cv::Mat Frame;
+		cv::resize(Small, Frame, cv::Size(Width, Height), 0, 0, cv::INTER_CUBIC);
+		std::vector<uchar> Payload;
+		if (bRaw)
+		{
+			Payload.assign(Frame.data, Frame.data + Frame.total() * Frame.elemSize());
+		}
+		else
+		{
+			cv::imencode(".jpg", Frame, Payload, { cv::IMWRITE_JPEG_QUALITY, 90 });
+		}
+
+		TUniquePtr<FLatencyHistogram> Arrival = MakeUnique<FLatencyHistogram>();
+		Arrival->SetWindow(Seconds + 1.0);
+		std::atomic<bool> bRunning{ true };
+		std::atomic<int32> Received{ 0 };
+		TArray<TFuture<void>> Threads;
+		const FFrameIngestServer::FStats StartStats = Server->GetStats();
+		for (int32 Stream = 0; Stream < Streams; ++Stream)
+		{
+			Server->Subscribe(Stream);
+			Threads.Add(Async(EAsyncExecution::Thread, [&, Stream]()
+			{
+				ISocketSubsystem* Sockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+				TSharedRef<FInternetAddr> Address = Sockets->CreateInternetAddr();
+				bool bValid = false;
+				Address->SetIp(TEXT("127.0.0.1"), bValid);
+				Address->SetPort(Port);
+				FSocket* Socket = Sockets->CreateSocket(NAME_Stream, TEXT("VisionIngestBench"), Address->GetProtocolType());
+				if (!Socket || !Socket->Connect(*Address))
+				{
+					UE_LOG(LogVision, Error, TEXT("Ingest Bench Could Not Connect Stream %d"), Stream);
+					if (Socket) Sockets->DestroySocket(Socket);
+					return;
+				}
+				VisionWire::FFrameHeader Header{};
+				Header.Magic = VisionWire::FrameMagic;
+				Header.Version = VisionWire::FrameVersion;
+				Header.Format = static_cast<uint8_t>(bRaw ? VisionWire::EFrameFormat::BGR8 : VisionWire::EFrameFormat::Jpeg);
+				Header.Stream = static_cast<uint8_t>(Stream);
+				Header.Width = Width;
+				Header.Height = Height;
+				Header.PayloadSize = static_cast<uint32_t>(Payload.size());
+				double NextSend = FPlatformTime::Seconds();
+				while (bRunning)
+				{
+					++Header.Sequence;
+					// Same clock as the readers, so the timestamp gives the time from send to the frame being available
+					Header.TimestampUs = static_cast<uint64>(FPlatformTime::Seconds() * 1e6);
+					if (!SendAll(Socket, reinterpret_cast<const uint8*>(&Header), sizeof(Header))
+						|| !SendAll(Socket, Payload.data(), static_cast<int32>(Payload.size()))) break;
+					NextSend += FrameSeconds;
+					const double Wait = NextSend - FPlatformTime::Seconds();
+					if (Wait > 0.0) FPlatformProcess::Sleep(static_cast<float>(Wait));
+				}
+				Socket->Close();
+				Sockets->DestroySocket(Socket);
+			}));
+			Threads.Add(Async(EAsyncExecution::Thread, [&, Stream]()
+			{
+				FVisionFrame Latest;
+				while (bRunning)
+				{
+					if (!Server->WaitForFrame(Stream, Latest, 0.1)) continue;
+					const uint64 NowUs = static_cast<uint64>(FPlatformTime::Seconds() * 1e6);
+					Arrival->Record((NowUs - FMath::Min(NowUs, Latest.TimestampUs)) * 1000, FPlatformTime::Cycles64());
+					Received.fetch_add(1, std::memory_order_relaxed);
+				}
+			}));
+		}
+
+		FPlatformProcess::Sleep(static_cast<float>(Seconds));
+		const FFrameIngestServer::FRates Stats = FFrameIngestServer::GetRates(StartStats, Server->GetStats());
+		bRunning = false;
+		for (TFuture<void>& Thread : Threads)
+		{
+			Thread.Wait();
+		}
+		for (int32 Stream = 0; Stream < Streams; ++Stream)
+		{
+			Server->Unsubscribe(Stream);
+		}
+		Server.Reset();
+
+		const FVisionLatencyStats Decode = FVisionLatency::Get().GetStats(EVisionStage::IngestDecode);
+		const FVisionLatencyStats Available = Arrival->GetStats(FPlatformTime::Cycles64());
+		UE_LOG(LogVision, Display, TEXT("Ingest %d x %d x %d %s (%.0f KB) at 30 fps for %.0f s:"),
+			Streams, Width, Height, bRaw ? TEXT("BGR") : TEXT("JPEG"), Payload.size() / 1024.0, Seconds);
+		UE_LOG(LogVision, Display, TEXT("  %.1f fps decoded of %d sent, %.1f fps read, %.1f MB/s, %d dropped"),
+			Stats.FramesPerSecond, Streams * 30, Received.load() / Seconds, Stats.MegabytesPerSecond, Stats.Dropped);
+		UE_LOG(LogVision, Display, TEXT("  Decode %.2f ms mean, p50 %.2f ms, p99 %.2f ms"), Decode.MeanMs, Decode.P50Ms, Decode.P99Ms);
+		UE_LOG(LogVision, Display, TEXT("  Send to available p50 %.2f ms, p99 %.2f ms, max %.2f ms"), Available.P50Ms, Available.P99Ms, Available.MaxMs);
+	}
+
+	// The sockets and decode take seconds, so the bench runs off the game thread and logs when done
+	void BenchIngest(const TArray<FString>& Args)
+	{
+		const int32 Streams = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, static_cast<int32>(VisionWire::MaxStreams)) : 4;
+		const double Seconds = Args.Num() > 1 ? FMath::Max(1.0, FCString::Atod(*Args[1])) : 10.0;
+		const bool bRaw = Args.Num() > 2 && Args[2].Equals(TEXT("bgr"), ESearchCase::IgnoreCase);
+		Async(EAsyncExecution::Thread, [Streams, Seconds, bRaw]() { RunIngestBench(Streams, Seconds, bRaw); });
+	}
+
+	struct FBenchResult
+	{
+		FString Name;
+		double NsPerOp = 0.0;
+		// Bytes the operation reads and writes, the data it streams rather than what it allocates
+		double BytesPerOp = 0.0;
+		int64 Iterations = 0;
+	};
+
+	/*
+	 * Times Op the way Go's testing package does: the iteration count doubles until a batch takes
+	 * MinSeconds, then the best of three batches of that size is kept, which filters out most
+	 * scheduling noise. One call before timing moves first-use allocations out of the numbers.
+	 */
+	class FBenchSuite
+	{
+	public:
+		explicit FBenchSuite(double InMinSeconds) : MinSeconds(InMinSeconds) {}
+
+		template<typename FunctorType>
+		void Run(const FString& Name, double BytesPerOp, FunctorType&& Op)
+		{
+			Op();
+			auto Time = [&Op](int64 Iterations)
+			{
+				const uint64 Start = FPlatformTime::Cycles64();
+				for (int64 i = 0; i < Iterations; ++i)
+				{
+					Op();
+				}
+				return FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - Start);
+			};
+			int64 Iterations = 1;
+			double Seconds = Time(Iterations);
+			while (Seconds < MinSeconds && Iterations < (1ll << 32))
+			{
+				const int64 Predicted = static_cast<int64>(Iterations * MinSeconds * 1.2 / FMath::Max(Seconds, 1e-9));
+				Iterations = FMath::Clamp<int64>(Predicted, Iterations * 2, Iterations * 100);
+				Seconds = Time(Iterations);
+			}
+			for (int32 Repeat = 0; Repeat < 2; ++Repeat)
+			{
+				Seconds = FMath::Min(Seconds, Time(Iterations));
+			}
+
+			FBenchResult& Result = Results.AddDefaulted_GetRef();
+			Result.Name = Name;
+			Result.NsPerOp = Seconds * 1e9 / Iterations;
+			Result.BytesPerOp = BytesPerOp;
+			Result.Iterations = Iterations;
+			UE_LOG(LogVision, Display, TEXT("  %-40s %14.1f ns/op %12.0f B/op %8.2f GB/s"), *Name, Result.NsPerOp, BytesPerOp, BytesPerOp / Result.NsPerOp);
+		}
+
+		FString ToJson(const FString& Input) const
+		{
+			FString Json = FString::Printf(TEXT("{\n  \"cpu\": \"%s\",\n  \"input\": \"%s\",\n  \"results\": {"),
+				*FPlatformMisc::GetCPUBrand().TrimStartAndEnd(), *Input.ReplaceCharWithEscapedChar());
+			for (int32 i = 0; i < Results.Num(); ++i)
+			{
+				Json += FString::Printf(TEXT("%s\n    \"%s\": {\"ns_per_op\": %.1f, \"bytes_per_op\": %.0f, \"iterations\": %lld}"),
+					i > 0 ? TEXT(",") : TEXT(""), *Results[i].Name, Results[i].NsPerOp, Results[i].BytesPerOp, Results[i].Iterations);
+			}
+			Json += TEXT("\n  }\n}\n");
+			return Json;
+		}
+
+		// Log every case against the baseline, returns the number slower by more than Threshold
+		int32 Compare(const FString& BaselineJson, double Threshold) const
+		{
+			TSharedPtr<FJsonObject> Baseline;
+			const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(BaselineJson);
+			const TSharedPtr<FJsonObject>* BaselineResults = nullptr;
+			if (!FJsonSerializer::Deserialize(Reader, Baseline) || !Baseline.IsValid() || !Baseline->TryGetObjectField(TEXT("results"), BaselineResults))
+			{
+				UE_LOG(LogVision, Warning, TEXT("Benchmark Baseline Is Not Valid"));
+				return 0;
+			}
+			int32 Regressions = 0;
+			for (const FBenchResult& Result : Results)
+			{
+				const TSharedPtr<FJsonObject>* Case = nullptr;
+				double BaseNs = 0.0;
+				if (!(*BaselineResults)->TryGetObjectField(Result.Name, Case) || !(*Case)->TryGetNumberField(TEXT("ns_per_op"), BaseNs) || BaseNs <= 0.0)
+				{
+					UE_LOG(LogVision, Display, TEXT("  %-40s new"), *Result.Name);
+					continue;
+				}
+				const double Change = Result.NsPerOp / BaseNs - 1.0;
+				if (Change > Threshold)
+				{
+					++Regressions;
+					UE_LOG(LogVision, Warning, TEXT("  %-40s %+6.1f%% (%.1f ns/op, baseline %.1f) REGRESSION"), *Result.Name, Change * 100.0, Result.NsPerOp, BaseNs);
+				}
+				else
+				{
+					UE_LOG(LogVision, Display, TEXT("  %-40s %+6.1f%%"), *Result.Name, Change * 100.0);
+				}
+			}
+			return Regressions;
+		}
+
+	private:
+		double MinSeconds;
+		TArray<FBenchResult> Results;
+	};
+
+	// Synthetic SSD detection_out of [1, 1, NumRows, 7], NumHits rows above Confidence
+	cv::Mat MakeSSDOutput(int32 NumRows, int32 NumHits, float Confidence, int32 Seed)
+	{
+		FRandomStream Random(Seed);
+		const int Sizes[] = { 1, 1, NumRows, 7 };
+		cv::Mat Output(4, Sizes, CV_32F);
+		float* Row = Output.ptr<float>();
+		for (int32 i = 0; i < NumRows; ++i, Row += 7)
+		{
+			const float X = Random.FRandRange(0.f, 0.9f);
+			const float Y = Random.FRandRange(0.f, 0.9f);
+			Row[0] = 0.f;
+			Row[1] = 1.f;
+			Row[2] = i < NumHits ? Random.FRandRange(Confidence + 0.01f, 1.f) : Random.FRandRange(0.f, Confidence * 0.9f);
+			Row[3] = X;
+			Row[4] = Y;
+			Row[5] = X + Random.FRandRange(0.02f, 0.1f);
+			Row[6] = Y + Random.FRandRange(0.02f, 0.1f);
+		}
+		return Output;
+	}
+
+	void RunSuite(const FString& Options)
+	{
+		FString ImagePath;
+		FString BaselinePath = FPaths::ProjectConfigDir() / TEXT("VisionBenchBaseline.json");
+		double MinSeconds = 0.1;
+		double Threshold = 0.1;
+		FParse::Value(*Options, TEXT("image="), ImagePath);
+		FParse::Value(*Options, TEXT("baseline="), BaselinePath);
+		FParse::Value(*Options, TEXT("seconds="), MinSeconds);
+		FParse::Value(*Options, TEXT("threshold="), Threshold);
+		const bool bSave = FParse::Param(*Options, TEXT("save"));
+
+		// A recorded frame when given, smooth noise that compresses and resizes like a camera image otherwise
+		cv::Mat Frame;
+		if (!ImagePath.IsEmpty())
+		{
+			Frame = cv::imread(TCHAR_TO_UTF8(*ImagePath), cv::IMREAD_COLOR);
+			if (Frame.empty()) UE_LOG(LogVision, Warning, TEXT("Could Not Read %s, Using A Synthetic Frame"), *ImagePath);
+		}
+		if (Frame.empty())
+		{
+			cv::Mat Small(1080 / 8, 1920 / 8, CV_8UC3);
+			cv::randu(Small, cv::Scalar::all(0), cv::Scalar::all(255));
+			cv::resize(Small, Frame, cv::Size(1920, 1080), 0, 0, cv::INTER_CUBIC);
+			ImagePath = TEXT("synthetic");
+		}
+		const double FrameBytes = static_cast<double>(Frame.total() * Frame.elemSize());
+		UE_LOG(LogVision, Display, TEXT("Vision Benchmark Suite, %d x %d Frame (%s):"), Frame.cols, Frame.rows, *ImagePath);
+		FBenchSuite Suite(MinSeconds);
+
+		// Letterbox to the Yolov5 input
+		FVisionPipelineConfig Config;
+		int Width = 0, Height = 0, Top = 0, Left = 0;
+		cv::Mat Resized;
+		for (const bool bKeepRatio : { true, false })
+		{
+			Config.DoKeepRatio = bKeepRatio;
+			Suite.Run(FString::Printf(TEXT("ResizeImage/%s/%d"), bKeepRatio ? TEXT("KeepRatio") : TEXT("Stretch"), Config.Yolov5Width),
+				FrameBytes + Config.Yolov5Width * Config.Yolov5Height * 3.0,
+				[&]() { Resized = ACVProcessor::ResizeImage(Frame, Config, &Width, &Height, &Top, &Left); });
+		}
+
+		// The resize path hands blobFromImage the letterboxed input, the other path the whole frame
+		cv::Mat Blob;
+		for (const int32 Size : { 640, 320 })
+		{
+			Suite.Run(FString::Printf(TEXT("BlobFromImage/Frame/%d"), Size), FrameBytes + Size * Size * 3.0 * sizeof(float),
+				[&]() { Blob = cv::dnn::blobFromImage(Frame, 1 / 255.0, cv::Size(Size, Size), cv::Scalar(0, 0, 0), true, false); });
+		}
+		Suite.Run(TEXT("BlobFromImage/Letterboxed/640"), Resized.total() * Resized.elemSize() + 640 * 640 * 3.0 * sizeof(float),
+			[&]() { Blob = cv::dnn::blobFromImage(Resized, 1 / 255.0, cv::Size(640, 640), cv::Scalar(0, 0, 0), true, false); });
+
+		// Raw Yolov5 heads decoded into a detection buffer, as DecodeRawHead does
+		TArray<float> Proposals;
+		TArray<int32> Survivors;
+		FDetectionBuffer Raw;
+		Raw.Reserve(MaxRawDetections);
+		const int32 NumRows = FYoloHead640Decoder::NumProposals(640, 640);
+		Survivors.SetNumUninitialized(NumRows);
+		FYoloDecodeParams Params;
+		Params.NumRows = NumRows;
+		Params.Survivors = Survivors.GetData();
+		auto Sink = [&Raw](float Score, int32 ClassId, float CenterX, float CenterY, float BoxWidth, float BoxHeight)
+		{
+			Raw.Add(CenterX - 0.5f * BoxWidth, CenterY - 0.5f * BoxHeight, BoxWidth, BoxHeight, CenterX, CenterY, Score, ClassId);
+		};
+		for (const float HitRate : { 0.001f, 0.01f, 0.05f })
+		{
+			MakeProposals(Proposals, NumRows, FYoloHead640Decoder::RowLength, HitRate, Params.ObjectThreshold, 1234);
+			Params.Data = Proposals.GetData();
+			Suite.Run(FString::Printf(TEXT("Yolov5Decode/Head640/%.1f%%"), HitRate * 100.f), Proposals.Num() * sizeof(float),
+				[&]() { Raw.Reset(); FYoloHead640Decoder::Decode(Params, Anchors640, Sink); });
+			MakeProposals(Proposals, NumRows, FYoloCoco640Decoder::RowLength, HitRate, Params.ObjectThreshold, 1234);
+			Params.Data = Proposals.GetData();
+			Suite.Run(FString::Printf(TEXT("Yolov5Decode/Coco640/%.1f%%"), HitRate * 100.f), Proposals.Num() * sizeof(float),
+				[&]() { Raw.Reset(); FYoloCoco640Decoder::Decode(Params, Anchors640, Sink); });
+		}
+
+		// NMSBoxes next to the engine the pipeline runs
+		std::vector<cv::Rect> Boxes;
+		std::vector<float> Scores;
+		std::vector<int> Indices;
+		TArray<float> X, Y, BoxWidth, BoxHeight;
+		TArray<int32> Classes, Kept;
+		FNMSEngine Engine;
+		const FNMSConfig NMSConfig;
+		for (const int32 Num : { 50, 500, 5000 })
+		{
+			MakeCandidates(Boxes, Scores, Num, 99);
+			X.SetNumUninitialized(Num);
+			Y.SetNumUninitialized(Num);
+			BoxWidth.SetNumUninitialized(Num);
+			BoxHeight.SetNumUninitialized(Num);
+			Classes.SetNumZeroed(Num);
+			for (int32 i = 0; i < Num; ++i)
+			{
+				X[i] = static_cast<float>(Boxes[i].x);
+				Y[i] = static_cast<float>(Boxes[i].y);
+				BoxWidth[i] = static_cast<float>(Boxes[i].width);
+				BoxHeight[i] = static_cast<float>(Boxes[i].height);
+			}
+			const double CandidateBytes = Num * (4 * sizeof(float) + sizeof(float) + sizeof(int32));
+			Suite.Run(FString::Printf(TEXT("NMSBoxes/%d"), Num), CandidateBytes,
+				[&]() { cv::dnn::NMSBoxes(Boxes, Scores, NMSConfig.ScoreThreshold, NMSConfig.IoUThreshold, Indices); });
+			Suite.Run(FString::Printf(TEXT("NMSEngine/%d"), Num), CandidateBytes,
+				[&]() { Engine.Run(X.GetData(), Y.GetData(), BoxWidth.GetData(), BoxHeight.GetData(), Scores.data(), Classes.GetData(), Num, NMSConfig, Kept); });
+		}
+
+		// Capture conversion of BGRA cameras, and the preview's swizzle into a texture upload buffer
+		cv::Mat Bgra, Bgr;
+		cv::cvtColor(Frame, Bgra, cv::COLOR_BGR2BGRA);
+		Suite.Run(TEXT("Convert/BGRA2BGR"), Frame.total() * 7.0, [&]() { cv::cvtColor(Bgra, Bgr, cv::COLOR_BGRA2BGR); });
+		TArray<uint8> Upload;
+		Upload.SetNumUninitialized(Frame.total() * 4);
+		Suite.Run(TEXT("Convert/SwizzleBGR2BGRA"), Frame.total() * 7.0,
+			[&]() { SwizzleBGRToBGRA(Frame.ptr(), static_cast<int32>(Frame.step), Upload.GetData(), Frame.cols * 4, Frame.cols, Frame.rows); });
+
+		// DetectSSDResFace's post-processing of the 200 rows of detection_out
+		FDetectionBuffer Faces;
+		Faces.Reserve(MaxDetections);
+		for (const int32 NumHits : { 5, 50 })
+		{
+			const cv::Mat Output = MakeSSDOutput(200, NumHits, Config.SSDResConfidence, 7);
+			Suite.Run(FString::Printf(TEXT("SSDResDecode/%d"), NumHits), Output.total() * sizeof(float),
+				[&]() { Faces.Reset(); ACVProcessor::DecodeSSDResFaces(Output, Frame.cols, Frame.rows, Config.SSDResConfidence, Faces); });
+		}
+
+		// What every VISION_SCOPED_STAGE adds for its latency histogram, into a histogram of its own so the live ones stay clean
+		TUniquePtr<FLatencyHistogram> Histogram = MakeUnique<FLatencyHistogram>();
+		uint64 LatencyNs = 1000;
+		Suite.Run(TEXT("LatencyRecord"), 0.0, [&]()
+		{
+			Histogram->Record(LatencyNs, FPlatformTime::Cycles64());
+			LatencyNs = LatencyNs * 7 % 10000019;
+		});
+
+		const FString Json = Suite.ToJson(ImagePath);
+		const FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("VisionBench-%s.json"), *FDateTime::Now().ToString());
+		FFileHelper::SaveStringToFile(Json, *OutputPath);
+		UE_LOG(LogVision, Display, TEXT("Benchmark Results Written To %s"), *OutputPath);
+
+		FString BaselineJson;
+		if (FFileHelper::LoadFileToString(BaselineJson, *BaselinePath))
+		{
+			UE_LOG(LogVision, Display, TEXT("Against %s:"), *BaselinePath);
+			const int32 Regressions = Suite.Compare(BaselineJson, Threshold);
+			UE_LOG(LogVision, Display, TEXT("%d Regression(s) Above %.0f%%"), Regressions, Threshold * 100.0);
+		}
+		else if (!bSave)
+		{
+			// No baseline ships with the project, it is machine specific
+			UE_LOG(LogVision, Display, TEXT("No Baseline At %s, Run With -save To Create One"), *BaselinePath);
+		}
+		if (bSave)
+		{
+			FFileHelper::SaveStringToFile(Json, *BaselinePath);
+			UE_LOG(LogVision, Display, TEXT("Baseline Saved To %s"), *BaselinePath);
+		}
+	}
+
+	// Takes a few seconds, so it runs off the game thread and logs when done
+	void BenchSuite(const TArray<FString>& Args)
+	{
+		const FString Options = FString::Join(Args, TEXT(" "));
+		Async(EAsyncExecution::Thread, [Options]() { RunSuite(Options); });
+	}
+
+	FAutoConsoleCommand BenchSuiteCommand(
+		TEXT("CV.Bench.Suite"),
+		TEXT("Time every hot path step, write ns/op and bytes/op as JSON and compare with a baseline. Args: [-image=Frame.png] [-baseline=Path] [-save] [-seconds=0.1] [-threshold=0.1]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchSuite));
+
+	FAutoConsoleCommand BenchIngestCommand(
+		TEXT("CV.Bench.Ingest"),
+		TEXT("Send 1080p frames at 30 fps per stream over loopback through the frame ingest server. Args: [Streams] [Seconds] [jpeg|bgr]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchIngest));
+
+	FAutoConsoleCommand BenchSwizzleCommand(
+		TEXT("CV.Bench.Swizzle"),
+		TEXT("Compare BGR to BGRA conversions of a 1080p frame into a texture upload buffer. Args: [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchSwizzle));
+
+	FAutoConsoleCommand BenchTrackerCommand(
+		TEXT("CV.Bench.Tracker"),
+		TEXT("Time FObjectTracker updates with 10, 40 and 100 moving targets. Args: [Frames]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchTracker));
+
+	FAutoConsoleCommand BenchNMSCommand(
+		TEXT("CV.Bench.NMS"),
+		TEXT("Compare FNMSEngine modes with cv::dnn::NMSBoxes at 50, 500 and 5000 candidates. Args: [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchNMS));
+
+	FAutoConsoleCommand BenchObjectnessCommand(
+		TEXT("CV.Bench.Objectness"),
+		TEXT("Compare the SIMD objectness pre-filter with the scalar row loop. Args: [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchObjectness));
+}
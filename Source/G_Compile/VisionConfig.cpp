@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VisionConfig.h"
+#include "JsonObjectConverter.h"
+#include "Misc/FileHelper.h"
+#include "VisionLog.h"
+
+void FVisionPipelineConfig::Validate()
+{
+	// The grid of the largest stride has to divide the input
+	const int32 Align = Yolov5StrideNum == 4 ? 64 : 32;
+	Yolov5StrideNum = Yolov5StrideNum == 4 ? 4 : 3;
+	Yolov5Width = FMath::Max(Align, Yolov5Width / Align * Align);
+	Yolov5Height = FMath::Max(Align, Yolov5Height / Align * Align);
+	Yolov3Width = FMath::Max(32, Yolov3Width / 32 * 32);
+	Yolov3Height = FMath::Max(32, Yolov3Height / 32 * 32);
+	SSDResWidth = FMath::Max(1, SSDResWidth);
+	SSDResHeight = FMath::Max(1, SSDResHeight);
+
+	ObjectThreshold = FMath::Clamp(ObjectThreshold, 0.f, 1.f);
+	ConfigThreshold = FMath::Clamp(ConfigThreshold, 0.f, 1.f);
+	NMSThreshold = FMath::Clamp(NMSThreshold, 0.f, 1.f);
+	SSDResConfidence = FMath::Clamp(SSDResConfidence, 0.f, 1.f);
+	NMSTopK = FMath::Max(0, NMSTopK);
+	SoftNMSMode = FMath::Clamp(SoftNMSMode, 0, 2);
+	SoftNMSSigma = FMath::Max(KINDA_SMALL_NUMBER, SoftNMSSigma);
+	GridNMSMinCandidates = FMath::Max(0, GridNMSMinCandidates);
+
+	Yolov5TargetHz = FMath::Max(0.f, Yolov5TargetHz);
+	Yolov3TargetHz = FMath::Max(0.f, Yolov3TargetHz);
+	SSDResTargetHz = FMath::Max(0.f, SSDResTargetHz);
+	Yolov5DeadlineMs = FMath::Max(0.f, Yolov5DeadlineMs);
+	Yolov3DeadlineMs = FMath::Max(0.f, Yolov3DeadlineMs);
+	SSDResDeadlineMs = FMath::Max(0.f, SSDResDeadlineMs);
+	FrameBudgetMs = FMath::Max(1.f, FrameBudgetMs);
+
+	TrackHighThreshold = FMath::Clamp(TrackHighThreshold, 0.f, 1.f);
+	TrackLowThreshold = FMath::Clamp(TrackLowThreshold, 0.f, TrackHighThreshold);
+	TrackMinHits = FMath::Max(1, TrackMinHits);
+	TrackMaxCoastSeconds = FMath::Max(0.f, TrackMaxCoastSeconds);
+	PredictionHorizonMs = FMath::Max(0.f, PredictionHorizonMs);
+
+	PreviewTargetHz = FMath::Max(0.f, PreviewTargetHz);
+	PreviewWidth = FMath::Max(0, PreviewWidth);
+	ProfileWindow = FMath::Max(1, ProfileWindow);
+	ProfileTopN = FMath::Max(1, ProfileTopN);
+}
+
+bool FVisionPipelineConfig::Equals(const FVisionPipelineConfig& Other) const
+{
+	return StaticStruct()->CompareScriptStruct(this, &Other, 0);
+}
+
+bool FVisionPipelineConfig::ChangesYolov5Input(const FVisionPipelineConfig& Other) const
+{
+	return Yolov5Width != Other.Yolov5Width || Yolov5Height != Other.Yolov5Height || Yolov5StrideNum != Other.Yolov5StrideNum;
+}
+
+bool FVisionPipelineConfig::ChangesSchedule(const FVisionPipelineConfig& Other) const
+{
+	return Yolov5TargetHz != Other.Yolov5TargetHz || Yolov5Priority != Other.Yolov5Priority || Yolov5DeadlineMs != Other.Yolov5DeadlineMs
+		|| Yolov3TargetHz != Other.Yolov3TargetHz || Yolov3Priority != Other.Yolov3Priority || Yolov3DeadlineMs != Other.Yolov3DeadlineMs
+		|| SSDResTargetHz != Other.SSDResTargetHz || SSDResPriority != Other.SSDResPriority || SSDResDeadlineMs != Other.SSDResDeadlineMs
+		|| FrameBudgetMs != Other.FrameBudgetMs || ProfileWindow != Other.ProfileWindow || ProfileTopN != Other.ProfileTopN;
+}
+
+bool FVisionPipelineConfig::ChangesTracker(const FVisionPipelineConfig& Other) const
+{
+	return TrackYolov5 != Other.TrackYolov5 || TrackHighThreshold != Other.TrackHighThreshold || TrackLowThreshold != Other.TrackLowThreshold
+		|| TrackMinHits != Other.TrackMinHits || TrackMaxCoastSeconds != Other.TrackMaxCoastSeconds || PredictionHorizonMs != Other.PredictionHorizonMs;
+}
+
+bool FVisionPipelineConfig::LoadFromFile(const FString& Path)
+{
+	FString Json;
+	if (!FFileHelper::LoadFileToString(Json, *Path)) return false;
+	FVisionPipelineConfig Loaded = *this;
+	if (!FJsonObjectConverter::JsonObjectStringToUStruct(Json, &Loaded, 0, 0))
+	{
+		UE_LOG(LogVision, Warning, TEXT("Pipeline Config Is Not Valid JSON: %s"), *Path);
+		return false;
+	}
+	Loaded.Validate();
+	*this = Loaded;
+	return true;
+}
+
+bool FVisionPipelineConfig::SaveToFile(const FString& Path) const
+{
+	FString Json;
+	return FJsonObjectConverter::UStructToJsonObjectString(*this, Json) && FFileHelper::SaveStringToFile(Json, *Path);
+}
@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "VisionConfig.generated.h"
+
+// Capacity of the per frame detection buffers, reserved once
+constexpr int32 MaxRawDetections = 8192;
+constexpr int32 MaxDetections = 256;
+
+/* Layout of the Yolov5 output tensor */
+UENUM(BlueprintType)
+enum class EYoloOutputFormat : uint8
+{
+	// Detect from the output shape on the first forward, shapes that fit both layouts need the format set
+	Auto,
+	// [proposals, 5 + classes] straight from the detection head, decoded with grid and anchors
+	RawHead,
+	// Boxes decoded in the graph, optionally after NMS: [N, 6] of (x0, y0, x1, y1, score, class),
+	// or the ONNX Runtime end-to-end [N, 7] of (batch, x0, y0, x1, y1, class, score)
+	Detections
+};
+
+/*
+ * Tunable settings of the vision pipeline, one copy per ACVProcessor.
+ * Loaded from a JSON file under the project's Config directory, edited as a UPROPERTY and applied
+ * by the reader thread at the start of the next frame, so changes need neither a recompile nor a
+ * restart of the capture.
+ */
+USTRUCT(BlueprintType)
+struct G_COMPILE_API FVisionPipelineConfig
+{
+	GENERATED_BODY()
+
+	/* Input */
+	// Read frames from the network instead of the camera, only looked at when play begins
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool UseTCP = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool DoEnhanceImage = false;
+
+	/* Models */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool UseYolov5 = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool UseYolov3 = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool UseSSDRes = false;
+
+	/* Yolov5 */
+	// Output layout of the loaded model
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EYoloOutputFormat Yolov5OutputFormat = EYoloOutputFormat::Auto;
+	// Letterbox the frame to the input size instead of stretching it, keeping the aspect when DoKeepRatio is set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool DoResizeImage = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool DoKeepRatio = true;
+	// Network input size, a multiple of the largest stride. A size the loaded model does not take is refused
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int Yolov5Width = 640;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int Yolov5Height = 640;
+	// Detection levels of the model, 3 for the 640 models and 4 for the 1280 ones
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int Yolov5StrideNum = 3;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float ObjectThreshold = 0.3f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float ConfigThreshold = 0.3f;
+
+	/* NMS */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float NMSThreshold = 0.5f;
+	// Only suppress boxes of the same class
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool ClassAwareNMS = true;
+	// Best candidates taken into NMS, 0 keeps all
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int NMSTopK = 0;
+	// 0 hard NMS, 1 linear Soft-NMS, 2 gaussian Soft-NMS
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int SoftNMSMode = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float SoftNMSSigma = 0.5f;
+	// Candidate count from which NMS only compares boxes in the same grid cell
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int GridNMSMinCandidates = 1000;
+
+	/* Yolov3 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int Yolov3Width = 416;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int Yolov3Height = 416;
+
+	/* ResNet SSD */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int SSDResWidth = 300;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int SSDResHeight = 300;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float SSDResConfidence = 0.5f;
+
+	/* Scheduler */
+	// Target rate, priority (higher first) and in-frame deadline of each model
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Yolov5TargetHz = 30.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int Yolov5Priority = 2;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Yolov5DeadlineMs = 33.3f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Yolov3TargetHz = 5.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int Yolov3Priority = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Yolov3DeadlineMs = 33.3f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float SSDResTargetHz = 10.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int SSDResPriority = 1;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float SSDResDeadlineMs = 33.3f;
+	// Time available for inference on one captured frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float FrameBudgetMs = 33.3f;
+
+	/* Tracking */
+	// Follow Yolov5 detections over time and report them with persistent IDs through ShowYolov5Tracks.
+	// Off by default: it lowers the Yolov5 decode and NMS floor to TrackLowThreshold, which costs more per frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool TrackYolov5 = false;
+	// Detections above the high threshold start and match tracks, down to the low threshold they only keep tracks alive
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float TrackHighThreshold = 0.5f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float TrackLowThreshold = 0.1f;
+	// Matches before a track is reported, and how long it is kept without one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int TrackMinHits = 2;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float TrackMaxCoastSeconds = 1.f;
+	// Move tracks from their capture time to the current game time with their velocity, at most by the horizon
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool PredictTracks = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float PredictionHorizonMs = 100.f;
+
+	/* Preview */
+	// Rate and width of the camera preview, the height follows the frame aspect. 0 sends every frame or keeps the full width
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float PreviewTargetHz = 15.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int PreviewWidth = 960;
+	// Upload every preview the way ConvertMat2Texture2D did, a new transient texture per frame converted on the
+	// game thread, to compare the preview counters of ACVProcessor with the in-place update
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool LegacyPreviewUpload = false;
+
+	/* Profiling */
+	// Collect per-layer timings of every network, written to Saved/Profiling/DNNProfile.csv
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool ProfileNetworks = false;
+	// Number of forwards aggregated per report
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int ProfileWindow = 300;
+	// Number of slowest layers reported per network
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int ProfileTopN = 10;
+
+	// Clamp every value into the range the pipeline handles
+	void Validate();
+	bool Equals(const FVisionPipelineConfig& Other) const;
+	// Whether Other needs the Yolov5 output layout resolved again
+	bool ChangesYolov5Input(const FVisionPipelineConfig& Other) const;
+	// Whether Other needs the scheduler or the tracker configured again, the tracker then starts over
+	bool ChangesSchedule(const FVisionPipelineConfig& Other) const;
+	bool ChangesTracker(const FVisionPipelineConfig& Other) const;
+
+	// Fields missing from the file keep their current value
+	bool LoadFromFile(const FString& Path);
+	bool SaveToFile(const FString& Path) const;
+};
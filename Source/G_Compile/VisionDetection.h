@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "VisionDetection.generated.h"
+
+/* One detected or tracked target as handed to Blueprint, positions in camera frame pixels */
+USTRUCT(BlueprintType)
+struct FVisionDetection
+{
+	GENERATED_BODY()
+
+	// Persistent track ID, -1 for untracked detections
+	UPROPERTY(BlueprintReadOnly)
+	int32 ID = -1;
+	// Top left corner and size of the box
+	UPROPERTY(BlueprintReadOnly)
+	FVector2D Position = FVector2D::ZeroVector;
+	UPROPERTY(BlueprintReadOnly)
+	FVector2D Size = FVector2D::ZeroVector;
+	UPROPERTY(BlueprintReadOnly)
+	FVector2D Center = FVector2D::ZeroVector;
+	UPROPERTY(BlueprintReadOnly)
+	float Score = 0.f;
+	UPROPERTY(BlueprintReadOnly)
+	int32 ClassID = 0;
+	// Captured frame the detection comes from
+	UPROPERTY(BlueprintReadOnly)
+	int64 Sequence = 0;
+	// World time the position refers to, the capture time plus any extrapolation
+	UPROPERTY(BlueprintReadOnly)
+	float Timestamp = 0.f;
+};
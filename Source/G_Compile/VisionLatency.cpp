@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VisionLatency.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "VisionLog.h"
+
+void FLatencyHistogram::FSlice::Clear()
+{
+	for (std::atomic<uint32>& Count : Counts)
+	{
+		Count.store(0, std::memory_order_relaxed);
+	}
+	Total.store(0, std::memory_order_relaxed);
+	SumNs.store(0, std::memory_order_relaxed);
+	MaxNs.store(0, std::memory_order_relaxed);
+}
+
+FLatencyHistogram::FLatencyHistogram()
+{
+	for (FSlice& Slice : Slices)
+	{
+		Slice.Clear();
+	}
+	SetWindow(10.0);
+}
+
+void FLatencyHistogram::SetWindow(double Seconds)
+{
+	const double SliceSeconds = FMath::Max(0.1, Seconds) / NumSlices;
+	SliceCycles.store(static_cast<uint64>(SliceSeconds / FPlatformTime::GetSecondsPerCycle64()), std::memory_order_relaxed);
+}
+
+int32 FLatencyHistogram::GetBucket(uint64 Nanoseconds)
+{
+	if (Nanoseconds < 2 * SubBuckets) return static_cast<int32>(Nanoseconds);
+	const int32 Shift = static_cast<int32>(FPlatformMath::FloorLog2_64(Nanoseconds)) - SubBucketBits;
+	if (Shift > MaxShift) return NumBuckets - 1;
+	return SubBuckets * (Shift + 1) + static_cast<int32>(Nanoseconds >> Shift) - SubBuckets;
+}
+
+uint64 FLatencyHistogram::GetBucketLow(int32 Bucket)
+{
+	if (Bucket < 2 * SubBuckets) return Bucket;
+	const int32 Shift = Bucket / SubBuckets - 1;
+	return static_cast<uint64>(SubBuckets + Bucket % SubBuckets) << Shift;
+}
+
+uint64 FLatencyHistogram::GetBucketHigh(int32 Bucket)
+{
+	if (Bucket < 2 * SubBuckets) return Bucket;
+	return GetBucketLow(Bucket) + (1ull << (Bucket / SubBuckets - 1)) - 1;
+}
+
+void FLatencyHistogram::Record(uint64 Nanoseconds, uint64 NowCycles)
+{
+	if (NowCycles >= SliceEndCycles.load(std::memory_order_relaxed))
+	{
+		Advance(NowCycles);
+	}
+	FSlice& Slice = Slices[Active.load(std::memory_order_relaxed)];
+	Slice.Counts[GetBucket(Nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	Slice.Total.fetch_add(1, std::memory_order_relaxed);
+	Slice.SumNs.fetch_add(Nanoseconds, std::memory_order_relaxed);
+	uint64 Max = Slice.MaxNs.load(std::memory_order_relaxed);
+	while (Nanoseconds > Max && !Slice.MaxNs.compare_exchange_weak(Max, Nanoseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+void FLatencyHistogram::Advance(uint64 NowCycles)
+{
+	uint64 End = SliceEndCycles.load(std::memory_order_relaxed);
+	if (NowCycles < End) return;
+	const uint64 Step = FMath::Max<uint64>(1, SliceCycles.load(std::memory_order_relaxed));
+	// Only the thread that moves the end clears, everyone else keeps recording into the current slice
+	const uint64 Elapsed = End > 0 ? (NowCycles - End) / Step + 1 : NumSlices;
+	if (!SliceEndCycles.compare_exchange_strong(End, NowCycles + Step, std::memory_order_relaxed)) return;
+
+	int32 Slice = Active.load(std::memory_order_relaxed);
+	for (uint64 i = 0; i < FMath::Min<uint64>(Elapsed, NumSlices); ++i)
+	{
+		Slice = (Slice + 1) % NumSlices;
+		Slices[Slice].Clear();
+	}
+	Active.store(Slice, std::memory_order_relaxed);
+}
+
+void FLatencyHistogram::Reset()
+{
+	for (FSlice& Slice : Slices)
+	{
+		Slice.Clear();
+	}
+}
+
+FVisionLatencyStats FLatencyHistogram::GetStats(uint64 NowCycles)
+{
+	// Drops slices that went stale while nothing was recorded
+	Advance(NowCycles);
+
+	FScopeLock Lock(&StatsLock);
+	Merged.SetNumZeroed(NumBuckets);
+	FMemory::Memzero(Merged.GetData(), NumBuckets * sizeof(uint64));
+	uint64 SumNs = 0, MaxNs = 0;
+	for (const FSlice& Slice : Slices)
+	{
+		if (Slice.Total.load(std::memory_order_relaxed) == 0) continue;
+		for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+		{
+			Merged[Bucket] += Slice.Counts[Bucket].load(std::memory_order_relaxed);
+		}
+		SumNs += Slice.SumNs.load(std::memory_order_relaxed);
+		MaxNs = FMath::Max(MaxNs, Slice.MaxNs.load(std::memory_order_relaxed));
+	}
+	// Counted from the buckets, so the percentiles are consistent even while records come in
+	uint64 Total = 0;
+	for (const uint64 Count : Merged)
+	{
+		Total += Count;
+	}
+
+	FVisionLatencyStats Stats;
+	if (Total == 0) return Stats;
+	Stats.Count = static_cast<int64>(Total);
+	Stats.MeanMs = static_cast<float>(SumNs / static_cast<double>(Total) * 1e-6);
+	Stats.MaxMs = static_cast<float>(MaxNs * 1e-6);
+
+	const double Quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	float* const Outputs[] = { &Stats.P50Ms, &Stats.P90Ms, &Stats.P99Ms, &Stats.P999Ms };
+	int32 Next = 0;
+	uint64 Seen = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets && Next < UE_ARRAY_COUNT(Quantiles); ++Bucket)
+	{
+		Seen += Merged[Bucket];
+		// The highest value of the bucket, so a percentile never reads lower than the samples it covers
+		while (Next < UE_ARRAY_COUNT(Quantiles) && Seen > 0 && Seen >= static_cast<uint64>(FMath::CeilToDouble(Quantiles[Next] * Total)))
+		{
+			*Outputs[Next++] = static_cast<float>(FMath::Min(GetBucketHigh(Bucket), MaxNs) * 1e-6);
+		}
+	}
+	return Stats;
+}
+
+FVisionLatency& FVisionLatency::Get()
+{
+	static FVisionLatency Instance;
+	return Instance;
+}
+
+void FVisionLatency::SetWindow(double Seconds)
+{
+	WindowSeconds = FMath::Max(0.1, Seconds);
+	for (FLatencyHistogram& Histogram : Histograms)
+	{
+		Histogram.SetWindow(WindowSeconds);
+	}
+}
+
+void FVisionLatency::Reset()
+{
+	for (FLatencyHistogram& Histogram : Histograms)
+	{
+		Histogram.Reset();
+	}
+}
+
+FVisionLatencyStats FVisionLatency::GetStats(EVisionStage Stage)
+{
+	if (Stage >= EVisionStage::Num) return FVisionLatencyStats();
+	return Histograms[static_cast<int32>(Stage)].GetStats(FPlatformTime::Cycles64());
+}
+
+FString FVisionLatency::ToJson()
+{
+	FString Json = FString::Printf(TEXT("{\n  \"window_seconds\": %.1f,\n  \"stages\": {"), WindowSeconds);
+	bool bFirst = true;
+	for (int32 i = 0; i < static_cast<int32>(EVisionStage::Num); ++i)
+	{
+		const EVisionStage Stage = static_cast<EVisionStage>(i);
+		const FVisionLatencyStats Stats = GetStats(Stage);
+		Json += FString::Printf(TEXT("%s\n    \"%s\": {\"count\": %lld, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"p999_ms\": %.4f, \"max_ms\": %.4f}"),
+			bFirst ? TEXT("") : TEXT(","), GetStageName(Stage), Stats.Count, Stats.MeanMs, Stats.P50Ms, Stats.P90Ms, Stats.P99Ms, Stats.P999Ms, Stats.MaxMs);
+		bFirst = false;
+	}
+	Json += TEXT("\n  }\n}\n");
+	return Json;
+}
+
+bool FVisionLatency::DumpJson(const FString& Path)
+{
+	return FFileHelper::SaveStringToFile(ToJson(), *Path);
+}
+
+const TCHAR* FVisionLatency::GetStageName(EVisionStage Stage)
+{
+	switch (Stage)
+	{
+	case EVisionStage::Capture: return TEXT("Capture");
+	case EVisionStage::Convert: return TEXT("Convert");
+	case EVisionStage::Preview: return TEXT("Preview");
+	case EVisionStage::Yolov5: return TEXT("Yolov5");
+	case EVisionStage::Resize: return TEXT("Resize");
+	case EVisionStage::Yolov5Blob: return TEXT("Yolov5Blob");
+	case EVisionStage::Yolov5Forward: return TEXT("Yolov5Forward");
+	case EVisionStage::Yolov5Decode: return TEXT("Yolov5Decode");
+	case EVisionStage::Yolov5NMS: return TEXT("Yolov5NMS");
+	case EVisionStage::Yolov3: return TEXT("Yolov3");
+	case EVisionStage::Yolov3Blob: return TEXT("Yolov3Blob");
+	case EVisionStage::Yolov3Forward: return TEXT("Yolov3Forward");
+	case EVisionStage::Yolov3Decode: return TEXT("Yolov3Decode");
+	case EVisionStage::Yolov3NMS: return TEXT("Yolov3NMS");
+	case EVisionStage::SSDRes: return TEXT("SSDRes");
+	case EVisionStage::SSDResBlob: return TEXT("SSDResBlob");
+	case EVisionStage::SSDResForward: return TEXT("SSDResForward");
+	case EVisionStage::SSDResDecode: return TEXT("SSDResDecode");
+	case EVisionStage::Tracker: return TEXT("Tracker");
+	case EVisionStage::Publish: return TEXT("Publish");
+	case EVisionStage::Submit: return TEXT("Submit");
+	case EVisionStage::Tick: return TEXT("Tick");
+	case EVisionStage::IngestDecode: return TEXT("IngestDecode");
+	case EVisionStage::Ingest: return TEXT("Ingest");
+	case EVisionStage::EndToEnd: return TEXT("EndToEnd");
+	default: return TEXT("Unknown");
+	}
+}
+
+namespace
+{
+	void PrintLatency(const TArray<FString>& Args)
+	{
+		FVisionLatency& Latency = FVisionLatency::Get();
+		UE_LOG(LogVision, Display, TEXT("Stage Latency Over %.0f s (ms):        Count    Mean     p50     p90     p99   p99.9     Max"), Latency.GetWindow());
+		for (int32 i = 0; i < static_cast<int32>(EVisionStage::Num); ++i)
+		{
+			const EVisionStage Stage = static_cast<EVisionStage>(i);
+			const FVisionLatencyStats Stats = Latency.GetStats(Stage);
+			if (Stats.Count == 0) continue;
+			UE_LOG(LogVision, Display, TEXT("  %-34s %7lld %7.3f %7.3f %7.3f %7.3f %7.3f %7.3f"), FVisionLatency::GetStageName(Stage),
+				Stats.Count, Stats.MeanMs, Stats.P50Ms, Stats.P90Ms, Stats.P99Ms, Stats.P999Ms, Stats.MaxMs);
+		}
+	}
+
+	void DumpLatency(const TArray<FString>& Args)
+	{
+		const FString Path = Args.Num() > 0 ? Args[0]
+			: FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("VisionLatency-%s.json"), *FDateTime::Now().ToString());
+		if (FVisionLatency::Get().DumpJson(Path))
+		{
+			UE_LOG(LogVision, Display, TEXT("Stage Latency Written To %s"), *Path);
+		}
+		else
+		{
+			UE_LOG(LogVision, Warning, TEXT("Stage Latency Could Not Be Written To %s"), *Path);
+		}
+	}
+
+	void SetLatencyWindow(const TArray<FString>& Args)
+	{
+		if (Args.Num() > 0)
+		{
+			FVisionLatency::Get().SetWindow(FCString::Atod(*Args[0]));
+		}
+		FVisionLatency::Get().Reset();
+	}
+
+	FAutoConsoleCommand LatencyCommand(
+		TEXT("CV.Latency"),
+		TEXT("Log p50/p90/p99/p99.9/max of every pipeline stage over the rolling window"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&PrintLatency));
+
+	FAutoConsoleCommand LatencyDumpCommand(
+		TEXT("CV.Latency.Dump"),
+		TEXT("Write the stage latency percentiles to Saved/Profiling as JSON. Args: [Path]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&DumpLatency));
+
+	FAutoConsoleCommand LatencyResetCommand(
+		TEXT("CV.Latency.Reset"),
+		TEXT("Clear the stage latency histograms, optionally with a new window length. Args: [Seconds]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&SetLatencyWindow));
+}
@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+#include "VisionLatency.generated.h"
+
+// Pipeline stages with a latency histogram, named like their VISION_SCOPED_STAGE counters
+UENUM(BlueprintType)
+enum class EVisionStage : uint8
+{
+	Capture,
+	Convert,
+	Preview,
+	// Every model's steps have stages of their own, so one model's tail does not hide in another's
+	Yolov5,
+	Resize,
+	Yolov5Blob,
+	Yolov5Forward,
+	Yolov5Decode,
+	Yolov5NMS,
+	Yolov3,
+	Yolov3Blob,
+	Yolov3Forward,
+	Yolov3Decode,
+	Yolov3NMS,
+	SSDRes,
+	SSDResBlob,
+	SSDResForward,
+	SSDResDecode,
+	Tracker,
+	Publish,
+	Submit,
+	Tick,
+	// Decode of a network frame, and its arrival to the decoded image being ready
+	IngestDecode,
+	Ingest,
+	// Camera capture to the result reaching the game thread
+	EndToEnd,
+	Num UMETA(Hidden)
+};
+
+/* Latency percentiles of one stage over the rolling window, in milliseconds */
+USTRUCT(BlueprintType)
+struct FVisionLatencyStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 Count = 0;
+	UPROPERTY(BlueprintReadOnly)
+	float MeanMs = 0.f;
+	UPROPERTY(BlueprintReadOnly)
+	float P50Ms = 0.f;
+	UPROPERTY(BlueprintReadOnly)
+	float P90Ms = 0.f;
+	UPROPERTY(BlueprintReadOnly)
+	float P99Ms = 0.f;
+	UPROPERTY(BlueprintReadOnly)
+	float P999Ms = 0.f;
+	UPROPERTY(BlueprintReadOnly)
+	float MaxMs = 0.f;
+};
+
+/*
+ * Log-linear latency histogram in the style of HdrHistogram.
+ * Values are nanoseconds. Below 64 ns every value has its own bucket, above that every power of
+ * two is split into 32 buckets, so a percentile is within about 3% of the true value anywhere
+ * from nanoseconds to a minute. Counts are relaxed atomics, recording is a few instructions and
+ * never blocks. The window is a ring of slices: recording goes into the newest slice, and the
+ * oldest slice is cleared and reused once the newest is full, so reports cover the last window
+ * with the resolution of one slice. A record racing with the reuse of its slice may be lost.
+ */
+class G_COMPILE_API FLatencyHistogram
+{
+public:
+	static constexpr int32 SubBucketBits = 5;
+	static constexpr int32 SubBuckets = 1 << SubBucketBits;
+	// Up to 2^36 ns, about 68 seconds, longer values land in the last bucket
+	static constexpr int32 MaxShift = 31;
+	static constexpr int32 NumBuckets = SubBuckets * (MaxShift + 2);
+	static constexpr int32 NumSlices = 5;
+
+	FLatencyHistogram();
+
+	void SetWindow(double Seconds);
+	void Record(uint64 Nanoseconds, uint64 NowCycles);
+	void Reset();
+	FVisionLatencyStats GetStats(uint64 NowCycles);
+
+	static int32 GetBucket(uint64 Nanoseconds);
+	// Lowest and highest value counted in Bucket
+	static uint64 GetBucketLow(int32 Bucket);
+	static uint64 GetBucketHigh(int32 Bucket);
+
+private:
+	struct FSlice
+	{
+		std::atomic<uint32> Counts[NumBuckets];
+		std::atomic<uint64> Total{ 0 };
+		std::atomic<uint64> SumNs{ 0 };
+		std::atomic<uint64> MaxNs{ 0 };
+
+		void Clear();
+	};
+
+	// Move the newest slice forward to NowCycles, clearing the slices that fell out of the window
+	void Advance(uint64 NowCycles);
+
+	FSlice Slices[NumSlices];
+	std::atomic<int32> Active{ 0 };
+	std::atomic<uint64> SliceEndCycles{ 0 };
+	std::atomic<uint64> SliceCycles{ 0 };
+	// Merged counts of the last report, only used by GetStats
+	TArray<uint64> Merged;
+	FCriticalSection StatsLock;
+};
+
+/*
+ * Histograms of every pipeline stage, shared by all threads.
+ * Stages are recorded through VISION_SCOPED_STAGE, reported with CV.Latency and written as JSON
+ * with CV.Latency.Dump.
+ */
+class G_COMPILE_API FVisionLatency
+{
+public:
+	static FVisionLatency& Get();
+
+	void SetWindow(double Seconds);
+	double GetWindow() const { return WindowSeconds; }
+	FORCEINLINE void Record(EVisionStage Stage, uint64 Nanoseconds)
+	{
+		Histograms[static_cast<int32>(Stage)].Record(Nanoseconds, FPlatformTime::Cycles64());
+	}
+	void Reset();
+
+	FVisionLatencyStats GetStats(EVisionStage Stage);
+	FString ToJson();
+	bool DumpJson(const FString& Path);
+	static const TCHAR* GetStageName(EVisionStage Stage);
+
+private:
+	double WindowSeconds = 10.0;
+	FLatencyHistogram Histograms[static_cast<int32>(EVisionStage::Num)];
+};
+
+/* Records the lifetime of the scope into the histogram of Stage */
+class FVisionScopedLatency
+{
+public:
+	explicit FVisionScopedLatency(EVisionStage InStage) : Stage(InStage), Start(FPlatformTime::Cycles64()) {}
+	~FVisionScopedLatency()
+	{
+		FVisionLatency::Get().Record(Stage, static_cast<uint64>(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - Start) * 1e9));
+	}
+
+private:
+	EVisionStage Stage;
+	uint64 Start;
+};
@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VisionLog.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY(LogVision);
+
+namespace
+{
+	// How often the streaming thread drains the rings, well inside the time a ring takes to wrap
+	constexpr float StreamIntervalSeconds = 0.1f;
+
+	FString MakeTracePath(const TCHAR* Prefix)
+	{
+		return FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("%s-%s.csv"), Prefix, *FDateTime::Now().ToString());
+	}
+}
+
+FVisionTrace& FVisionTrace::Get()
+{
+	static FVisionTrace Instance;
+	return Instance;
+}
+
+uint64 FVisionTrace::CopyRing(FRing& Ring, uint64 From, TArray<TPair<const FRing*, FVisionTraceRecord>>& Out) const
+{
+	// The owner fills the slot of index Written before it counts it, which overwrites index Written - RingCapacity,
+	// so only the RingCapacity - 1 records below Written are whole
+	const uint64 Written = Ring.Written.load(std::memory_order_acquire);
+	const uint64 First = FMath::Max(From, Written >= RingCapacity ? Written + 1 - RingCapacity : 0);
+	const int32 Start = Out.Num();
+	for (uint64 Index = First; Index < Written; ++Index)
+	{
+		Out.Emplace(&Ring, Ring.Records[Index & (RingCapacity - 1)]);
+	}
+	// Records the owner wrapped over while they were copied are dropped, the same way
+	const uint64 After = Ring.Written.load(std::memory_order_acquire);
+	if (After + 1 > First + RingCapacity)
+	{
+		const int32 Torn = static_cast<int32>(FMath::Min<uint64>(After + 1 - RingCapacity - First, Written - First));
+		Out.RemoveAt(Start, Torn, false);
+	}
+	return Written;
+}
+
+void FVisionTrace::AppendCsv(const TArray<TPair<const FRing*, FVisionTraceRecord>>& Records, FString& Out)
+{
+	for (const TPair<const FRing*, FVisionTraceRecord>& Entry : Records)
+	{
+		const FVisionTraceRecord& Record = Entry.Value;
+		Out += FString::Printf(TEXT("%.3f,%s,%s,%d,%g,%g,%g,%g\n"), FPlatformTime::ToMilliseconds64(Record.Cycles) * 1000.0,
+			*Entry.Key->ThreadName, GetEventName(Record.Event), Record.Arg0, Record.Args[0], Record.Args[1], Record.Args[2], Record.Args[3]);
+	}
+}
+
+int32 FVisionTrace::Dump(const FString& Path)
+{
+	TArray<TPair<const FRing*, FVisionTraceRecord>> Records;
+	Rings.ForEach([this, &Records](FRing& Ring) { CopyRing(Ring, 0, Records); });
+	Records.Sort([](const TPair<const FRing*, FVisionTraceRecord>& A, const TPair<const FRing*, FVisionTraceRecord>& B) { return A.Value.Cycles < B.Value.Cycles; });
+
+	FString Csv = TEXT("TimeUs,Thread,Event,Arg0,Arg1,Arg2,Arg3,Arg4\n");
+	AppendCsv(Records, Csv);
+	FFileHelper::SaveStringToFile(Csv, *Path);
+	UE_LOG(LogVision, Log, TEXT("Trace: %d records written to %s"), Records.Num(), *Path);
+	return Records.Num();
+}
+
+void FVisionTrace::StartStreaming(const FString& Path)
+{
+	bool bExpected = false;
+	if (!bStreaming.compare_exchange_strong(bExpected, true)) return;
+	StreamTask = Async(EAsyncExecution::Thread, [this, Path]() { StreamLoop(Path); });
+}
+
+void FVisionTrace::StopStreaming()
+{
+	if (!bStreaming.exchange(false)) return;
+	StreamTask.Wait();
+}
+
+void FVisionTrace::StreamLoop(FString Path)
+{
+	TUniquePtr<FArchive> File(IFileManager::Get().CreateFileWriter(*Path));
+	if (!File)
+	{
+		UE_LOG(LogVision, Warning, TEXT("Trace: could not open %s"), *Path);
+		bStreaming.store(false);
+		return;
+	}
+	UE_LOG(LogVision, Log, TEXT("Trace: streaming to %s"), *Path);
+
+	// Only records from now on, what is already in the rings belongs to Dump
+	Rings.ForEach([](FRing& Ring) { Ring.Streamed = Ring.Written.load(std::memory_order_acquire); });
+
+	FTCHARToUTF8 Header(TEXT("TimeUs,Thread,Event,Arg0,Arg1,Arg2,Arg3,Arg4\n"));
+	File->Serialize(const_cast<ANSICHAR*>(Header.Get()), Header.Length());
+	TArray<TPair<const FRing*, FVisionTraceRecord>> Records;
+	FString Csv;
+	while (bStreaming.load())
+	{
+		FPlatformProcess::Sleep(StreamIntervalSeconds);
+		Records.Reset();
+		Rings.ForEach([this, &Records](FRing& Ring) { Ring.Streamed = CopyRing(Ring, Ring.Streamed, Records); });
+		if (Records.Num() == 0) continue;
+		Records.Sort([](const TPair<const FRing*, FVisionTraceRecord>& A, const TPair<const FRing*, FVisionTraceRecord>& B) { return A.Value.Cycles < B.Value.Cycles; });
+		Csv.Reset();
+		AppendCsv(Records, Csv);
+		FTCHARToUTF8 Utf8(*Csv);
+		File->Serialize(const_cast<ANSICHAR*>(Utf8.Get()), Utf8.Length());
+		File->Flush();
+	}
+	File->Close();
+}
+
+const TCHAR* FVisionTrace::GetEventName(EVisionTraceEvent Event)
+{
+	switch (Event)
+	{
+	case EVisionTraceEvent::FrameCaptured: return TEXT("FrameCaptured");
+	case EVisionTraceEvent::ModelRun: return TEXT("ModelRun");
+	case EVisionTraceEvent::Heads: return TEXT("Heads");
+	case EVisionTraceEvent::Bodies: return TEXT("Bodies");
+	case EVisionTraceEvent::Faces: return TEXT("Faces");
+	case EVisionTraceEvent::Detection: return TEXT("Detection");
+	case EVisionTraceEvent::Face: return TEXT("Face");
+	case EVisionTraceEvent::TrackerUpdate: return TEXT("TrackerUpdate");
+	case EVisionTraceEvent::PreviewSent: return TEXT("PreviewSent");
+	case EVisionTraceEvent::Published: return TEXT("Published");
+	default: return TEXT("Unknown");
+	}
+}
+
+namespace
+{
+	void SetTraceEnabled(const TArray<FString>& Args)
+	{
+		FVisionTrace::Get().SetEnabled(Args.Num() == 0 || FCString::Atoi(*Args[0]) != 0);
+	}
+
+	void DumpTrace(const TArray<FString>& Args)
+	{
+		FVisionTrace::Get().Dump(Args.Num() > 0 ? Args[0] : MakeTracePath(TEXT("VisionTrace")));
+	}
+
+	void StreamTrace(const TArray<FString>& Args)
+	{
+		if (Args.Num() == 0 || FCString::Atoi(*Args[0]) != 0)
+		{
+			// A stream of a disabled trace would stay empty
+			FVisionTrace::Get().SetEnabled(true);
+			FVisionTrace::Get().StartStreaming(MakeTracePath(TEXT("VisionTraceStream")));
+		}
+		else
+		{
+			FVisionTrace::Get().StopStreaming();
+		}
+	}
+
+	FAutoConsoleCommand TraceCommand(
+		TEXT("CV.Trace"),
+		TEXT("Record vision pipeline events into the per-thread trace rings, off by default. Args: [0|1]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&SetTraceEnabled));
+
+	FAutoConsoleCommand TraceDumpCommand(
+		TEXT("CV.Trace.Dump"),
+		TEXT("Write the events held by the trace rings to Saved/Profiling as CSV. Args: [Path]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&DumpTrace));
+
+	FAutoConsoleCommand TraceStreamCommand(
+		TEXT("CV.Trace.Stream"),
+		TEXT("Turn the trace on and continuously drain its rings into a CSV file under Saved/Profiling on a background thread. Args: [0|1]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&StreamTrace));
+}
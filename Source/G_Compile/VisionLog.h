@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "VisionThreadBuffers.h"
+
+#include <atomic>
+
+/*
+ * Log category of the vision pipeline. Shipping builds compile out everything below Warning,
+ * other builds keep all verbosities and filter at run time (log LogVision Verbose).
+ */
+#ifndef VISION_LOG_COMPILE_VERBOSITY
+#if UE_BUILD_SHIPPING
+#define VISION_LOG_COMPILE_VERBOSITY Warning
+#else
+#define VISION_LOG_COMPILE_VERBOSITY All
+#endif
+#endif
+
+DECLARE_LOG_CATEGORY_EXTERN(LogVision, Log, VISION_LOG_COMPILE_VERBOSITY);
+
+// Set to 0 to compile every VISION_TRACE out
+#ifndef VISION_TRACE_ENABLED
+#define VISION_TRACE_ENABLED 1
+#endif
+
+enum class EVisionTraceEvent : uint16
+{
+	FrameCaptured,  // Arg0 frame sequence
+	ModelRun,       // Arg0 model, Args[0] ms
+	Heads,          // Arg0 count
+	Bodies,         // Arg0 count
+	Faces,          // Arg0 count
+	Detection,      // Arg0 class, Args x, y, width, height
+	Face,           // Arg0 index, Args centre x, centre y, size, confidence
+	TrackerUpdate,  // Arg0 tracks, Args[0] us
+	PreviewSent,    // Arg0 staging slot, Args[0] width, Args[1] height
+	Published,      // Arg0 frame sequence
+	Num
+};
+
+struct FVisionTraceRecord
+{
+	uint64 Cycles;
+	EVisionTraceEvent Event;
+	uint16 Reserved;
+	int32 Arg0;
+	float Args[4];
+};
+
+/*
+ * Binary flight recorder for per-frame events.
+ * Every thread that records gets its own ring of fixed size records, so recording is a
+ * thread-local lookup and one store with no lock and no formatting. The oldest records are
+ * overwritten when a ring is full. Rings can be dumped as CSV on demand (CV.Trace.Dump) or
+ * streamed to a CSV file by a background thread that drains them (CV.Trace.Stream 1).
+ * Recording is off until CV.Trace 1 or a stream starts, until then a record is one relaxed load.
+ */
+class G_COMPILE_API FVisionTrace
+{
+public:
+	static constexpr int32 RingCapacity = 1 << 14;
+
+	static FVisionTrace& Get();
+
+	void SetEnabled(bool bInEnabled) { bEnabled.store(bInEnabled, std::memory_order_relaxed); }
+	bool IsEnabled() const { return bEnabled.load(std::memory_order_relaxed); }
+
+	FORCEINLINE void Record(EVisionTraceEvent Event, int32 Arg0, float A = 0.f, float B = 0.f, float C = 0.f, float D = 0.f)
+	{
+		if (IsEnabled())
+		{
+			Rings.GetForCurrentThread().Push(Event, Arg0, A, B, C, D);
+		}
+	}
+
+	// Write the records still held by every ring, oldest first. Returns the number written
+	int32 Dump(const FString& Path);
+	void StartStreaming(const FString& Path);
+	void StopStreaming();
+
+	static const TCHAR* GetEventName(EVisionTraceEvent Event);
+
+private:
+	struct FRing : FVisionThreadBuffer
+	{
+		// Only the owning thread writes, readers copy and then check nothing they copied was overwritten meanwhile
+		std::atomic<uint64> Written{ 0 };
+		uint64 Streamed = 0;
+		FVisionTraceRecord Records[RingCapacity];
+
+		FORCEINLINE void Push(EVisionTraceEvent Event, int32 Arg0, float A, float B, float C, float D)
+		{
+			const uint64 Index = Written.load(std::memory_order_relaxed);
+			FVisionTraceRecord& Record = Records[Index & (RingCapacity - 1)];
+			Record.Cycles = FPlatformTime::Cycles64();
+			Record.Event = Event;
+			Record.Arg0 = Arg0;
+			Record.Args[0] = A;
+			Record.Args[1] = B;
+			Record.Args[2] = C;
+			Record.Args[3] = D;
+			Written.store(Index + 1, std::memory_order_release);
+		}
+	};
+
+	// Copy the records of Ring from index From on, returns the index to continue from
+	uint64 CopyRing(FRing& Ring, uint64 From, TArray<TPair<const FRing*, FVisionTraceRecord>>& Out) const;
+	static void AppendCsv(const TArray<TPair<const FRing*, FVisionTraceRecord>>& Records, FString& Out);
+	void StreamLoop(FString Path);
+
+	std::atomic<bool> bEnabled{ false };
+	TVisionThreadBuffers<FRing> Rings;
+
+	std::atomic<bool> bStreaming{ false };
+	TFuture<void> StreamTask;
+};
+
+#if VISION_TRACE_ENABLED
+#define VISION_TRACE(Event, Arg0, ...) FVisionTrace::Get().Record(EVisionTraceEvent::Event, Arg0, ##__VA_ARGS__)
+#else
+#define VISION_TRACE(Event, Arg0, ...)
+#endif
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VisionStats.h"
+
+DEFINE_STAT(STAT_Vision_Capture);
+DEFINE_STAT(STAT_Vision_Convert);
+DEFINE_STAT(STAT_Vision_Preview);
+DEFINE_STAT(STAT_Vision_Yolov5);
+DEFINE_STAT(STAT_Vision_Resize);
+DEFINE_STAT(STAT_Vision_Yolov5Blob);
+DEFINE_STAT(STAT_Vision_Yolov5Forward);
+DEFINE_STAT(STAT_Vision_Yolov5Decode);
+DEFINE_STAT(STAT_Vision_Yolov5NMS);
+DEFINE_STAT(STAT_Vision_Yolov3);
+DEFINE_STAT(STAT_Vision_Yolov3Blob);
+DEFINE_STAT(STAT_Vision_Yolov3Forward);
+DEFINE_STAT(STAT_Vision_Yolov3Decode);
+DEFINE_STAT(STAT_Vision_Yolov3NMS);
+DEFINE_STAT(STAT_Vision_SSDRes);
+DEFINE_STAT(STAT_Vision_SSDResBlob);
+DEFINE_STAT(STAT_Vision_SSDResForward);
+DEFINE_STAT(STAT_Vision_SSDResDecode);
+DEFINE_STAT(STAT_Vision_Tracker);
+DEFINE_STAT(STAT_Vision_Publish);
+DEFINE_STAT(STAT_Vision_Submit);
+DEFINE_STAT(STAT_Vision_Tick);
+DEFINE_STAT(STAT_Vision_IngestDecode);
+
+DEFINE_STAT(STAT_Vision_CaptureFps);
+DEFINE_STAT(STAT_Vision_Yolov5Fps);
+DEFINE_STAT(STAT_Vision_Yolov3Fps);
+DEFINE_STAT(STAT_Vision_SSDResFps);
+DEFINE_STAT(STAT_Vision_DroppedInferences);
+DEFINE_STAT(STAT_Vision_DroppedPreviews);
+DEFINE_STAT(STAT_Vision_QueueDepth);
+DEFINE_STAT(STAT_Vision_TexturesCreated);
+DEFINE_STAT(STAT_Vision_LiveObjects);
+DEFINE_STAT(STAT_Vision_GarbageCollectMs);
+DEFINE_STAT(STAT_Vision_Heads);
+DEFINE_STAT(STAT_Vision_Tracks);
+
+CSV_DEFINE_CATEGORY(Vision, true);
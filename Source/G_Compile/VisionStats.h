@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "VisionLatency.h"
+#include "VisionTimeline.h"
+
+/*
+ * Stage timings and pipeline counters of ACVProcessor.
+ * Every stage is a cycle counter in STATGROUP_Vision (stat Vision), a timing stat of the
+ * Vision CSV category (csvprofile start), a latency histogram (CV.Latency) and a slice of the
+ * timeline capture (CV.Timeline), so overlays, captured CSVs, percentiles and traces all time
+ * the same scopes.
+ */
+DECLARE_STATS_GROUP(TEXT("Vision"), STATGROUP_Vision, STATCAT_Advanced);
+
+// Reader thread
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Capture"), STAT_Vision_Capture, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Convert"), STAT_Vision_Convert, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Preview"), STAT_Vision_Preview, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov5"), STAT_Vision_Yolov5, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Resize"), STAT_Vision_Resize, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov5 Blob"), STAT_Vision_Yolov5Blob, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov5 Forward"), STAT_Vision_Yolov5Forward, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov5 Decode"), STAT_Vision_Yolov5Decode, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov5 NMS"), STAT_Vision_Yolov5NMS, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov3"), STAT_Vision_Yolov3, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov3 Blob"), STAT_Vision_Yolov3Blob, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov3 Forward"), STAT_Vision_Yolov3Forward, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov3 Decode"), STAT_Vision_Yolov3Decode, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Yolov3 NMS"), STAT_Vision_Yolov3NMS, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SSDRes"), STAT_Vision_SSDRes, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SSDRes Blob"), STAT_Vision_SSDResBlob, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SSDRes Forward"), STAT_Vision_SSDResForward, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SSDRes Decode"), STAT_Vision_SSDResDecode, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tracker"), STAT_Vision_Tracker, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Publish"), STAT_Vision_Publish, STATGROUP_Vision, );
+// Game thread
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Texture Submit"), STAT_Vision_Submit, STATGROUP_Vision, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick"), STAT_Vision_Tick, STATGROUP_Vision, );
+// Frame ingest decode threads
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ingest Decode"), STAT_Vision_IngestDecode, STATGROUP_Vision, );
+
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Capture FPS"), STAT_Vision_CaptureFps, STATGROUP_Vision, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Yolov5 FPS"), STAT_Vision_Yolov5Fps, STATGROUP_Vision, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Yolov3 FPS"), STAT_Vision_Yolov3Fps, STATGROUP_Vision, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("SSDRes FPS"), STAT_Vision_SSDResFps, STATGROUP_Vision, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dropped Inferences"), STAT_Vision_DroppedInferences, STATGROUP_Vision, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dropped Previews"), STAT_Vision_DroppedPreviews, STATGROUP_Vision, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Uploads In Flight"), STAT_Vision_QueueDepth, STATGROUP_Vision, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Textures Created"), STAT_Vision_TexturesCreated, STATGROUP_Vision, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Live UObjects"), STAT_Vision_LiveObjects, STATGROUP_Vision, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Last GC ms"), STAT_Vision_GarbageCollectMs, STATGROUP_Vision, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Heads"), STAT_Vision_Heads, STATGROUP_Vision, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Tracks"), STAT_Vision_Tracks, STATGROUP_Vision, );
+
+CSV_DECLARE_CATEGORY_EXTERN(Vision);
+
+// Set to 0 to keep stage timings out of the latency histograms
+#ifndef VISION_LATENCY_ENABLED
+#define VISION_LATENCY_ENABLED 1
+#endif
+
+#if VISION_LATENCY_ENABLED
+#define VISION_SCOPED_LATENCY(Stage) FVisionScopedLatency ANONYMOUS_VARIABLE(VisionLatency_)(EVisionStage::Stage)
+#else
+#define VISION_SCOPED_LATENCY(Stage)
+#endif
+
+// Time the rest of the enclosing scope as pipeline stage Stage
+#define VISION_SCOPED_STAGE(Stage) \
+	SCOPE_CYCLE_COUNTER(STAT_Vision_##Stage); \
+	CSV_SCOPED_TIMING_STAT(Vision, Stage); \
+	VISION_SCOPED_LATENCY(Stage); \
+	VISION_TIMELINE_SCOPE(#Stage)
+
+// Set a counter both as a stat and as a CSV value
+#define VISION_SET_FLOAT_COUNTER(Counter, Value) \
+	SET_FLOAT_STAT(STAT_Vision_##Counter, Value); \
+	CSV_CUSTOM_STAT(Vision, Counter, static_cast<float>(Value), ECsvCustomStatOp::Set)
+
+#define VISION_SET_DWORD_COUNTER(Counter, Value) \
+	SET_DWORD_STAT(STAT_Vision_##Counter, Value); \
+	CSV_CUSTOM_STAT(Vision, Counter, static_cast<int32>(Value), ECsvCustomStatOp::Set)
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadManager.h"
+
+/* Identity of the thread a per-thread buffer belongs to */
+struct FVisionThreadBuffer
+{
+	uint32 ThreadId = 0;
+	FString ThreadName;
+};
+
+/*
+ * Per-thread buffers of the trace rings and the timeline.
+ * A thread makes its buffer on first use and finds it through a thread_local after that, so the
+ * recording path takes no lock. The registry owns every buffer for as long as it lives, which
+ * for the process-wide recorders is the process, so a thread never has to unregister and a
+ * reader can walk all of them under the lock. The thread_local is per BufferType, so there is
+ * one registry per buffer type.
+ */
+template<typename BufferType>
+class TVisionThreadBuffers
+{
+public:
+	BufferType& GetForCurrentThread()
+	{
+		static thread_local BufferType* ThreadBuffer = nullptr;
+		if (!ThreadBuffer)
+		{
+			TUniquePtr<BufferType> Buffer = MakeUnique<BufferType>();
+			Buffer->ThreadId = FPlatformTLS::GetCurrentThreadId();
+			Buffer->ThreadName = FThreadManager::GetThreadName(Buffer->ThreadId);
+			if (Buffer->ThreadName.IsEmpty())
+			{
+				Buffer->ThreadName = IsInGameThread() ? TEXT("GameThread") : FString::Printf(TEXT("Thread %u"), Buffer->ThreadId);
+			}
+			ThreadBuffer = Buffer.Get();
+			FScopeLock Lock(&BuffersLock);
+			Buffers.Add(MoveTemp(Buffer));
+		}
+		return *ThreadBuffer;
+	}
+
+	// Visit every thread's buffer, threads that start meanwhile wait for their first record
+	template<typename FunctorType>
+	void ForEach(FunctorType&& Functor)
+	{
+		FScopeLock Lock(&BuffersLock);
+		for (TUniquePtr<BufferType>& Buffer : Buffers)
+		{
+			Functor(*Buffer);
+		}
+	}
+
+private:
+	FCriticalSection BuffersLock;
+	TArray<TUniquePtr<BufferType>> Buffers;
+};
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VisionTimeline.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "VisionLog.h"
+
+namespace
+{
+	// Scopes still open when the capture ends get this long to close before the buffers are read
+	constexpr float CloseGraceSeconds = 0.05f;
+}
+
+FVisionTimeline& FVisionTimeline::Get()
+{
+	static FVisionTimeline Instance;
+	return Instance;
+}
+
+FString FVisionTimeline::MakeCapturePath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("VisionTimeline-%s.json"), *FDateTime::Now().ToString());
+}
+
+bool FVisionTimeline::StartCapture(float Seconds, const FString& Path)
+{
+	bool bExpected = false;
+	if (!bWriting.compare_exchange_strong(bExpected, true))
+	{
+		UE_LOG(LogVision, Warning, TEXT("Timeline: a capture is already running"));
+		return false;
+	}
+	if (!StopEvent)
+	{
+		StopEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	}
+	// A stop that came after the previous capture had finished must not end this one
+	StopEvent->Reset();
+	StartCycles = FPlatformTime::Cycles64();
+	Generation.fetch_add(1);
+	bCapturing.store(true);
+	UE_LOG(LogVision, Log, TEXT("Timeline: capturing %.1f s"), Seconds);
+	CaptureTask = Async(EAsyncExecution::Thread, [this, Seconds, Path]() { WriteCapture(Seconds, Path); });
+	return true;
+}
+
+void FVisionTimeline::StopCapture()
+{
+	// Started and stopped on the game thread, so a running capture has its event and task
+	if (!bWriting.load()) return;
+	StopEvent->Trigger();
+	CaptureTask.Wait();
+}
+
+void FVisionTimeline::Append(const FVisionTimelineRecord& Record)
+{
+	FBuffer& Buffer = Buffers.GetForCurrentThread();
+	const uint32 Current = Generation.load(std::memory_order_relaxed);
+	if (Buffer.Generation.load(std::memory_order_relaxed) != Current)
+	{
+		Buffer.Count.store(0, std::memory_order_relaxed);
+		Buffer.Generation.store(Current, std::memory_order_release);
+	}
+	// A full buffer keeps its first records, the capture is too long for this thread's rate
+	const int32 Index = Buffer.Count.load(std::memory_order_relaxed);
+	if (Index >= BufferCapacity) return;
+	Buffer.Records[Index] = Record;
+	Buffer.Count.store(Index + 1, std::memory_order_release);
+}
+
+void FVisionTimeline::RecordScope(const TCHAR* Name, uint64 Begin, uint64 End, int64 Arg)
+{
+	if (!IsCapturing()) return;
+	Append({ Name, Begin, End, Arg, EVisionTimelineEvent::Complete });
+}
+
+void FVisionTimeline::RecordFlow(const TCHAR* Name, int64 Id, bool bStart)
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+	Append({ Name, Now, Now, Id, bStart ? EVisionTimelineEvent::FlowStart : EVisionTimelineEvent::FlowEnd });
+}
+
+void FVisionTimeline::WriteCapture(float Seconds, FString Path)
+{
+	// What was recorded until a stop is still written
+	StopEvent->Wait(FTimespan::FromSeconds(FMath::Max(0.f, Seconds)));
+	bCapturing.store(false);
+	FPlatformProcess::Sleep(CloseGraceSeconds);
+
+	const uint32 Current = Generation.load();
+	auto Timestamp = [this](uint64 Cycles) { return Cycles > StartCycles ? FPlatformTime::ToMilliseconds64(Cycles - StartCycles) * 1000.0 : 0.0; };
+
+	FString Json = TEXT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	int32 NumEvents = 0;
+	Buffers.ForEach([&](const FBuffer& Buffer)
+	{
+		if (Buffer.Generation.load(std::memory_order_acquire) != Current) return;
+		const int32 Count = Buffer.Count.load(std::memory_order_acquire);
+		if (Count == 0) return;
+		Json += FString::Printf(TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n"),
+			Buffer.ThreadId, *Buffer.ThreadName.ReplaceCharWithEscapedChar());
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const FVisionTimelineRecord& Record = Buffer.Records[i];
+			switch (Record.Event)
+			{
+			case EVisionTimelineEvent::Complete:
+				Json += FString::Printf(TEXT("{\"name\":\"%s\",\"cat\":\"vision\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u"),
+					Record.Name, Timestamp(Record.Begin), Timestamp(Record.End) - Timestamp(Record.Begin), Buffer.ThreadId);
+				Json += Record.Arg != INDEX_NONE ? FString::Printf(TEXT(",\"args\":{\"frame\":%lld}},\n"), Record.Arg) : FString(TEXT("},\n"));
+				break;
+			case EVisionTimelineEvent::FlowStart:
+			case EVisionTimelineEvent::FlowEnd:
+				// Flow ends bind to the scope enclosing them, so the arrow lands on the slice that picked the work up
+				Json += FString::Printf(TEXT("{\"name\":\"%s\",\"cat\":\"vision\",\"ph\":\"%s\",\"id\":%lld,\"ts\":%.3f,\"pid\":1,\"tid\":%u},\n"),
+					Record.Name, Record.Event == EVisionTimelineEvent::FlowStart ? TEXT("s\"") : TEXT("f\",\"bp\":\"e\""),
+					Record.Arg, Timestamp(Record.Begin), Buffer.ThreadId);
+				break;
+			}
+			++NumEvents;
+		}
+	});
+	// The viewers accept a trailing comma, but not every JSON reader does
+	Json.RemoveFromEnd(TEXT(",\n"));
+	Json += TEXT("\n]}\n");
+
+	if (FFileHelper::SaveStringToFile(Json, *Path))
+	{
+		UE_LOG(LogVision, Log, TEXT("Timeline: %d events written to %s"), NumEvents, *Path);
+	}
+	else
+	{
+		UE_LOG(LogVision, Warning, TEXT("Timeline: could not write %s"), *Path);
+	}
+	bWriting.store(false);
+}
+
+namespace
+{
+	void CaptureTimeline(const TArray<FString>& Args)
+	{
+		const float Seconds = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 5.f;
+		FVisionTimeline::Get().StartCapture(Seconds, Args.Num() > 1 ? Args[1] : FVisionTimeline::MakeCapturePath());
+	}
+
+	FAutoConsoleCommand TimelineCommand(
+		TEXT("CV.Timeline"),
+		TEXT("Capture the pipeline stages of every thread as Chrome Trace Event JSON under Saved/Profiling. Args: [Seconds] [Path]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&CaptureTimeline));
+}
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "VisionThreadBuffers.h"
+
+#include <atomic>
+
+// Set to 0 to compile every timeline scope and flow out
+#ifndef VISION_TIMELINE_ENABLED
+#define VISION_TIMELINE_ENABLED 1
+#endif
+
+enum class EVisionTimelineEvent : uint8
+{
+	// A scope with begin and end
+	Complete,
+	// Start and end of an arrow between scopes, e.g. a frame queued on one thread and handled on another
+	FlowStart,
+	FlowEnd
+};
+
+struct FVisionTimelineRecord
+{
+	// Must be a string literal, only the pointer is kept
+	const TCHAR* Name;
+	uint64 Begin;
+	uint64 End;
+	int64 Arg;
+	EVisionTimelineEvent Event;
+};
+
+/*
+ * Timeline capture of the pipeline in Chrome Trace Event format.
+ * While a capture runs, every thread appends begin/end scopes and flow arrows to its own buffer,
+ * without locks. When the capture time is up a background thread writes all buffers as one JSON
+ * file, which chrome://tracing, Perfetto or Unreal Insights' trace import show with one track
+ * per thread. Outside a capture a scope costs one relaxed atomic load.
+ */
+class G_COMPILE_API FVisionTimeline
+{
+public:
+	static constexpr int32 BufferCapacity = 1 << 16;
+
+	static FVisionTimeline& Get();
+
+	// Record for Seconds and then write to Path, false while another capture is running
+	bool StartCapture(float Seconds, const FString& Path);
+	// End a running capture early and wait until it is written, so nothing of it outlives the module
+	void StopCapture();
+	FORCEINLINE bool IsCapturing() const { return bCapturing.load(std::memory_order_relaxed); }
+
+	void RecordScope(const TCHAR* Name, uint64 Begin, uint64 End, int64 Arg);
+	void RecordFlow(const TCHAR* Name, int64 Id, bool bStart);
+
+	static FString MakeCapturePath();
+
+private:
+	struct FBuffer : FVisionThreadBuffer
+	{
+		FBuffer() { Records.SetNumUninitialized(BufferCapacity); }
+
+		// Capture the records belong to, the owning thread starts over when a new capture begins
+		std::atomic<uint32> Generation{ 0 };
+		std::atomic<int32> Count{ 0 };
+		TArray<FVisionTimelineRecord> Records;
+	};
+
+	void Append(const FVisionTimelineRecord& Record);
+	void WriteCapture(float Seconds, FString Path);
+
+	std::atomic<bool> bCapturing{ false };
+	std::atomic<bool> bWriting{ false };
+	std::atomic<uint32> Generation{ 0 };
+	uint64 StartCycles = 0;
+	TVisionThreadBuffers<FBuffer> Buffers;
+	TFuture<void> CaptureTask;
+	// Wakes the capture thread before its time is up. Taken once and kept, like the instance itself
+	FEvent* StopEvent = nullptr;
+};
+
+/* Records the scope as a timeline slice when a capture is running */
+class FVisionTimelineScope
+{
+public:
+	explicit FVisionTimelineScope(const TCHAR* InName, int64 InArg = INDEX_NONE)
+		: Name(InName), Arg(InArg), Start(FVisionTimeline::Get().IsCapturing() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+	~FVisionTimelineScope()
+	{
+		if (Start != 0)
+		{
+			FVisionTimeline::Get().RecordScope(Name, Start, FPlatformTime::Cycles64(), Arg);
+		}
+	}
+
+private:
+	const TCHAR* Name;
+	int64 Arg;
+	uint64 Start;
+};
+
+#if VISION_TIMELINE_ENABLED
+#define VISION_TIMELINE_SCOPE(Name, ...) FVisionTimelineScope ANONYMOUS_VARIABLE(VisionTimeline_)(TEXT(Name), ##__VA_ARGS__)
+#define VISION_TIMELINE_FLOW_START(Name, Id) do { if (FVisionTimeline::Get().IsCapturing()) FVisionTimeline::Get().RecordFlow(TEXT(Name), static_cast<int64>(Id), true); } while (0)
+#define VISION_TIMELINE_FLOW_END(Name, Id) do { if (FVisionTimeline::Get().IsCapturing()) FVisionTimeline::Get().RecordFlow(TEXT(Name), static_cast<int64>(Id), false); } while (0)
+#else
+#define VISION_TIMELINE_SCOPE(Name, ...)
+#define VISION_TIMELINE_FLOW_START(Name, Id)
+#define VISION_TIMELINE_FLOW_END(Name, Id)
+#endif
@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/*
+ * Binary formats the vision pipeline shares with other processes.
+ * Plain C++ without engine types, so the stand-alone tools under Tools/ include this header as
+ * it is. All fields are little endian.
+ */
+
+#include <atomic>
+#include <cstdint>
+
+namespace VisionWire
+{
+	/* Frame ingest over TCP: every frame is one header followed by PayloadSize bytes */
+	constexpr uint32_t FrameMagic = 0x4D524656; // "VFRM"
+	constexpr uint16_t FrameVersion = 1;
+	constexpr uint16_t DefaultIngestPort = 9000;
+	// Largest frame accepted, and its payload as raw BGRA
+	constexpr uint32_t MaxFrameWidth = 3840;
+	constexpr uint32_t MaxFrameHeight = 2160;
+	constexpr uint32_t MaxFramePayload = MaxFrameWidth * MaxFrameHeight * 4u;
+	constexpr int32_t MaxStreams = 16;
+
+	enum class EFrameFormat : uint8_t
+	{
+		Jpeg = 0,
+		// Rows of Width pixels without padding
+		BGR8 = 1,
+		BGRA8 = 2
+	};
+
+	// Bytes per pixel of the raw formats, 0 for JPEG and unknown formats
+	constexpr uint32_t GetBytesPerPixel(uint8_t Format)
+	{
+		return Format == static_cast<uint8_t>(EFrameFormat::BGR8) ? 3u : Format == static_cast<uint8_t>(EFrameFormat::BGRA8) ? 4u : 0u;
+	}
+
+#pragma pack(push, 1)
+	struct FFrameHeader
+	{
+		uint32_t Magic;
+		uint16_t Version;
+		uint8_t Format;
+		// Camera the frame comes from, below MaxStreams
+		uint8_t Stream;
+		uint16_t Width;
+		uint16_t Height;
+		uint32_t PayloadSize;
+		// Set by the sender, kept with the frame and its results
+		uint64_t Sequence;
+		uint64_t TimestampUs;
+	};
+#pragma pack(pop)
+	static_assert(sizeof(FFrameHeader) == 32, "Frame header layout changed");
+
+	/*
+	 * Frame ring in shared memory, written by a capture process and read in place by ACVProcessor.
+	 * The region is an FRingHeader padded to RingHeaderSize, followed by NumSlots slots of SlotSize
+	 * bytes. A slot starts with the FFrameHeader of its frame, its pixels (BGR8 or BGRA8) start at
+	 * RingSlotHeaderSize.
+	 *
+	 * The producer never writes a slot a reader holds:
+	 *   Producer: WriteSlot = S, skip S if any Leases[i] == S + 1, write S, WriteSlot = NoSlot,
+	 *             LatestSlot = S, ++Published.
+	 *   Reader:   S = LatestSlot, Leases[i] = S + 1, give up the lease if WriteSlot == S.
+	 * Both sides store before they load with sequentially consistent atomics, so either the producer
+	 * sees the lease or the reader sees the write. A reader holds one lease at a time, so with at
+	 * least MaxRingReaders + 2 slots the producer always has a free slot.
+	 *
+	 * A producer restarting into a mapping that still exists clears Magic, waits until every reader
+	 * has given up its entry in Readers, and only then writes the header with Generation + 1. A
+	 * reader reopens the ring when Magic, Generation, the geometry or its own entry changed.
+	 */
+	constexpr uint32_t RingMagic = 0x474E5256; // "VRNG"
+	constexpr uint16_t RingVersion = 1;
+	constexpr uint32_t MaxRingReaders = 4;
+	constexpr uint32_t NoSlot = 0xFFFFFFFFu;
+	constexpr uint32_t RingHeaderSize = 4096;
+	// Keeps the pixels of every slot cache line aligned
+	constexpr uint32_t RingSlotHeaderSize = 64;
+	// Slots are padded to whole pages
+	constexpr uint32_t RingSlotAlignment = 4096;
+
+	struct FRingHeader
+	{
+		// Written last by the producer, a reader ignores the ring until it matches
+		std::atomic<uint32_t> Magic;
+		uint16_t Version;
+		uint16_t NumSlots;
+		uint32_t SlotSize;
+		// Bumped by every producer that writes the header, a reader that sees it change opens the ring again
+		std::atomic<uint32_t> Generation;
+		std::atomic<uint32_t> LatestSlot;
+		std::atomic<uint32_t> WriteSlot;
+		// Frames published so far, a count that stops moving means the producer is gone
+		std::atomic<uint64_t> Published;
+		// Entries claimed by readers, and the slot each of them holds as slot + 1
+		std::atomic<uint32_t> Readers[MaxRingReaders];
+		std::atomic<uint32_t> Leases[MaxRingReaders];
+	};
+	static_assert(sizeof(FRingHeader) <= RingHeaderSize, "Ring header does not fit its page");
+	static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+		"Ring atomics must be lock free to work across processes");
+
+	constexpr uint32_t GetRingSlotSize(uint32_t MaxPayload)
+	{
+		return (RingSlotHeaderSize + MaxPayload + RingSlotAlignment - 1) / RingSlotAlignment * RingSlotAlignment;
+	}
+
+	/*
+	 * Detections of a frame over UDP multicast: one datagram per published frame, an
+	 * FDetectionPacketHeader followed by Count FDetectionRecords. Every model's newest result is
+	 * included, so records of slower models repeat until they run again. Datagrams are never split,
+	 * a subscriber that misses one sees a gap in Sequence and simply waits for the next.
+	 */
+	constexpr uint32_t DetectionMagic = 0x54454456; // "VDET"
+	constexpr uint16_t DetectionVersion = 1;
+	// Administratively scoped, so routers do not forward it. The publisher sends on the loopback
+	// interface, so it reaches only processes of this machine, a subscriber joins it on 127.0.0.1
+	constexpr const char* DefaultDetectionGroup = "239.255.86.68";
+	constexpr const char* DetectionInterface = "127.0.0.1";
+	constexpr uint16_t DefaultDetectionPort = 9001;
+
+	enum class EDetectionSource : uint8_t
+	{
+		Yolov5Head = 0,
+		// Yolov5 heads after tracking, Id is the track
+		Yolov5Track = 1,
+		Yolov3Body = 2,
+		SSDResFace = 3
+	};
+
+#pragma pack(push, 1)
+	struct FDetectionPacketHeader
+	{
+		uint32_t Magic;
+		uint16_t Version;
+		uint16_t Count;
+		// Sequence and timestamp of the frame, as the camera or frame sender gave them
+		uint64_t Sequence;
+		uint64_t TimestampUs;
+		uint16_t FrameWidth;
+		uint16_t FrameHeight;
+		uint32_t Reserved;
+	};
+
+	struct FDetectionRecord
+	{
+		// Track ID for Yolov5Track, -1 otherwise
+		int32_t Id;
+		// Box in frame pixels, X and Y are the top left corner
+		float X;
+		float Y;
+		float Width;
+		float Height;
+		float Score;
+		uint16_t Class;
+		uint8_t Source;
+		uint8_t Reserved;
+	};
+#pragma pack(pop)
+	static_assert(sizeof(FDetectionPacketHeader) == 32, "Detection header layout changed");
+	static_assert(sizeof(FDetectionRecord) == 28, "Detection record layout changed");
+
+	// Keeps a packet within one UDP datagram
+	constexpr uint32_t MaxPacketDetections = 2048;
+	constexpr uint32_t MaxDetectionPacketSize = sizeof(FDetectionPacketHeader) + MaxPacketDetections * sizeof(FDetectionRecord);
+}
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YoloDecoder.h"
+
+#include "OpenCVLibrary.h"
+#include "opencv2/core/hal/intrin.hpp"
+
+int32 FilterObjectnessScalar(const float* Data, int32 NumRows, int32 RowLength, int32 ObjectnessColumn, float Threshold, int32* OutIndices)
+{
+	int32 NumKept = 0;
+	const float* Objectness = Data + ObjectnessColumn;
+	for (int32 Row = 0; Row < NumRows; ++Row, Objectness += RowLength)
+	{
+		if (*Objectness > Threshold)
+		{
+			OutIndices[NumKept++] = Row;
+		}
+	}
+	return NumKept;
+}
+
+int32 FilterObjectness(const float* Data, int32 NumRows, int32 RowLength, int32 ObjectnessColumn, float Threshold, int32* OutIndices)
+{
+	int32 NumKept = 0;
+	int32 Row = 0;
+#if CV_SIMD
+	using namespace cv;
+	constexpr int32 Lanes = v_float32::nlanes;
+	// One lane per row, the gather offsets stay fixed while the base pointer walks down the rows
+	int32 Offsets[Lanes];
+	for (int32 Lane = 0; Lane < Lanes; ++Lane)
+	{
+		Offsets[Lane] = Lane * RowLength + ObjectnessColumn;
+	}
+	const v_int32 GatherIndex = vx_load(Offsets);
+	const v_float32 Limit = vx_setall_f32(Threshold);
+	const float* Block = Data;
+	for (; Row + Lanes <= NumRows; Row += Lanes, Block += Lanes * RowLength)
+	{
+		uint32 Mask = static_cast<uint32>(v_signmask(v_lut(Block, GatherIndex) > Limit));
+		// Almost every block is empty at the hit rates we see, so the bit walk rarely runs
+		while (Mask)
+		{
+			OutIndices[NumKept++] = Row + static_cast<int32>(FMath::CountTrailingZeros(Mask));
+			Mask &= Mask - 1;
+		}
+	}
+	vx_cleanup();
+#endif
+	const float* Objectness = Data + static_cast<SIZE_T>(Row) * RowLength + ObjectnessColumn;
+	for (; Row < NumRows; ++Row, Objectness += RowLength)
+	{
+		if (*Objectness > Threshold)
+		{
+			OutIndices[NumKept++] = Row;
+		}
+	}
+	return NumKept;
+}
+
+float ArgMaxClass(const float* Scores, int32 NumClasses, int32& OutClass)
+{
+	float Best = Scores[0];
+	OutClass = 0;
+	int32 Class = 1;
+#if CV_SIMD
+	using namespace cv;
+	constexpr int32 Lanes = v_float32::nlanes;
+	if (NumClasses >= 2 * Lanes)
+	{
+		// Per-lane running maximum and the class it came from, strict compare keeps the first hit
+		int32 LaneIndex[Lanes];
+		for (int32 Lane = 0; Lane < Lanes; ++Lane)
+		{
+			LaneIndex[Lane] = Lane;
+		}
+		v_int32 Index = vx_load(LaneIndex);
+		const v_int32 Step = vx_setall_s32(Lanes);
+		v_float32 MaxScore = vx_load(Scores);
+		v_int32 MaxIndex = Index;
+		for (Class = Lanes; Class + Lanes <= NumClasses; Class += Lanes)
+		{
+			Index += Step;
+			const v_float32 Score = vx_load(Scores + Class);
+			const v_float32 Greater = Score > MaxScore;
+			MaxScore = v_select(Greater, Score, MaxScore);
+			MaxIndex = v_select(v_reinterpret_as_s32(Greater), Index, MaxIndex);
+		}
+
+		float LaneScore[Lanes];
+		v_store(LaneScore, MaxScore);
+		v_store(LaneIndex, MaxIndex);
+		vx_cleanup();
+		Best = LaneScore[0];
+		OutClass = LaneIndex[0];
+		for (int32 Lane = 1; Lane < Lanes; ++Lane)
+		{
+			if (LaneScore[Lane] > Best || (LaneScore[Lane] == Best && LaneIndex[Lane] < OutClass))
+			{
+				Best = LaneScore[Lane];
+				OutClass = LaneIndex[Lane];
+			}
+		}
+	}
+	else if (NumClasses > 1 && NumClasses + 5 >= Lanes)
+	{
+		// Few classes, e.g. head, hand and phone: one register that ends on the last class, and a second from
+		// class 0 when they do not fit one. Lanes in front of class 0 hold the box and objectness columns and are masked off.
+		static const int32 Window[32] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+			-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+		static_assert(Lanes <= 16, "Class mask window holds 16 lanes");
+		const int32 Start = NumClasses - Lanes;
+		const v_float32 Lowest = vx_setall_f32(TNumericLimits<float>::Lowest());
+		v_float32 Tail = vx_load(Scores + Start);
+		if (Start < 0)
+		{
+			Tail = v_select(v_reinterpret_as_f32(vx_load(Window + 16 + Start)), Tail, Lowest);
+		}
+		const v_float32 Head = Start > 0 ? vx_load(Scores) : Lowest;
+		Best = v_reduce_max(v_max(Head, Tail));
+		const v_float32 Max = vx_setall_f32(Best);
+		const uint32 HeadHits = static_cast<uint32>(v_signmask(Head == Max));
+		const uint32 TailHits = static_cast<uint32>(v_signmask(Tail == Max));
+		vx_cleanup();
+		// Head covers the lower classes, so its hit wins a tie
+		OutClass = HeadHits ? static_cast<int32>(FMath::CountTrailingZeros(HeadHits)) : Start + static_cast<int32>(FMath::CountTrailingZeros(TailHits));
+		return Best;
+	}
+#endif
+	for (; Class < NumClasses; ++Class)
+	{
+		if (Scores[Class] > Best)
+		{
+			Best = Scores[Class];
+			OutClass = Class;
+		}
+	}
+	return Best;
+}
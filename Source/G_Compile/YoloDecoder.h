@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Write the indices of the rows whose objectness column is above Threshold.
+ * Data is a row-major [NumRows, RowLength] proposal matrix. The objectness column is gathered
+ * and compared a full SIMD register of rows at a time, so the decoder only touches the rows
+ * that survive. OutIndices must hold NumRows entries. Returns the number of indices written.
+ */
+G_COMPILE_API int32 FilterObjectness(const float* Data, int32 NumRows, int32 RowLength, int32 ObjectnessColumn, float Threshold, int32* OutIndices);
+
+// Plain strided loop with the same contract, kept as the reference for FilterObjectness
+G_COMPILE_API int32 FilterObjectnessScalar(const float* Data, int32 NumRows, int32 RowLength, int32 ObjectnessColumn, float Threshold, int32* OutIndices);
+
+/*
+ * Best class score of one proposal and its index, ties resolve to the lowest class like a scalar scan.
+ * Scores are compared a SIMD register at a time with a per-lane running index. With fewer classes than
+ * two registers the last register is loaded to end on the last class, so it may read up to five floats
+ * in front of Scores: the box and objectness columns of a proposal row.
+ */
+G_COMPILE_API float ArgMaxClass(const float* Scores, int32 NumClasses, int32& OutClass);
+
+/* Anchor (width, height) pairs of each stride level */
+constexpr float Anchors640[3][6] = { {10.0,  13.0, 16.0,  30.0,  33.0,  23.0},
+							 {30.0,  61.0, 62.0,  45.0,  59.0,  119.0},
+							 {116.0, 90.0, 156.0, 198.0, 373.0, 326.0} };
+
+constexpr float Anchors1280[4][6] = { {19, 27, 44, 40, 38, 94},{96, 68, 86, 152, 180, 137},{140, 301, 303, 264, 238, 542},
+					   {436, 615, 739, 380, 925, 792} };
+
+struct FYoloDecodeParams
+{
+	const float* Data = nullptr;   // [NumRows, 5 + classes] raw head output
+	int32 NumRows = 0;
+	int32 InputWidth = 640;        // Network input size the grid is laid out on
+	int32 InputHeight = 640;
+	float ObjectThreshold = 0.3f;
+	float ConfigThreshold = 0.3f;
+	int32 NumClasses = 1;          // Only read by the runtime class count decoder
+	int32* Survivors = nullptr;    // Scratch for NumRows row indices
+};
+
+/*
+ * Decoder of a raw YOLOv5 detection head, specialized at compile time on the number of stride
+ * levels, anchors per level and classes. Rows are ordered stride level, anchor, grid row, grid
+ * column. Objectness is pre-filtered with FilterObjectness and the surviving rows are walked
+ * level by level, so there is no per-row level search and the class loop folds away for a
+ * single-class model. ClassNum 0 reads the class count from the params for mixed models that
+ * have no instantiation of their own. Every kept box is handed to Sink(Score, ClassId, CenterX, CenterY,
+ * Width, Height) in network input pixels.
+ */
+template<int32 StrideNum, int32 AnchorNum, int32 ClassNum>
+struct TYoloDecoder
+{
+	static_assert(StrideNum > 0 && AnchorNum > 0 && ClassNum >= 0, "Decoder needs at least one level and anchor");
+
+	// Row length of a fixed class count decoder
+	static constexpr int32 RowLength = 5 + ClassNum;
+	using FAnchorTable = float[StrideNum][AnchorNum * 2];
+
+	static int32 NumProposals(int32 InputWidth, int32 InputHeight)
+	{
+		int32 Rows = 0;
+		for (int32 lS = 0; lS < StrideNum; ++lS)
+		{
+			const int32 Stride = 8 << lS;
+			Rows += AnchorNum * ((InputWidth + Stride - 1) / Stride) * ((InputHeight + Stride - 1) / Stride);
+		}
+		return Rows;
+	}
+
+	template<typename SinkType>
+	static int32 Decode(const FYoloDecodeParams& Params, const FAnchorTable& Anchors, SinkType&& Sink)
+	{
+		const int32 NumClasses = ClassNum > 0 ? ClassNum : Params.NumClasses;
+		const int32 Length = 5 + NumClasses;
+		const int32 NumKept = FilterObjectness(Params.Data, Params.NumRows, Length, 4, Params.ObjectThreshold, Params.Survivors);
+		int32 Kept = 0;
+		int32 NumDecoded = 0;
+		int32 LevelStart = 0;
+		for (int32 lS = 0; lS < StrideNum; ++lS)
+		{
+			const int32 Stride = 8 << lS;
+			const float StrideF = static_cast<float>(Stride);
+			const int32 GridXNum = (Params.InputWidth + Stride - 1) / Stride;
+			const int32 GridSize = GridXNum * ((Params.InputHeight + Stride - 1) / Stride);
+			const int32 LevelEnd = LevelStart + AnchorNum * GridSize;
+			for (; Kept < NumKept && Params.Survivors[Kept] < LevelEnd; ++Kept)
+			{
+				const int32 RowIndex = Params.Survivors[Kept];
+				const float* Prediction = Params.Data + static_cast<SIZE_T>(RowIndex) * Length;
+				int32 ClassId = 0;
+				// The single-class fast path reads col5 directly
+				const float Score = (NumClasses == 1 ? Prediction[5] : ArgMaxClass(Prediction + 5, NumClasses, ClassId)) * Prediction[4];
+				if (Score <= Params.ConfigThreshold) continue;
+
+				const int32 Local = RowIndex - LevelStart;
+				const int32 lA = Local / GridSize;
+				const int32 Cell = Local - lA * GridSize;
+				const int32 lY = Cell / GridXNum;
+				const int32 lX = Cell - lY * GridXNum;
+				const float ScaledWidth = Prediction[2] * 2.f;
+				const float ScaledHeight = Prediction[3] * 2.f;
+				Sink(Score, ClassId,
+					(Prediction[0] * 2.f - 0.5f + lX) * StrideF,
+					(Prediction[1] * 2.f - 0.5f + lY) * StrideF,
+					ScaledWidth * ScaledWidth * Anchors[lS][lA * 2],
+					ScaledHeight * ScaledHeight * Anchors[lS][lA * 2 + 1]);
+				++NumDecoded;
+			}
+			LevelStart = LevelEnd;
+		}
+		return NumDecoded;
+	}
+
+};
+
+// Single-class head model and the 80-class COCO model at 640 (3 levels) and 1280 (4 levels)
+using FYoloHead640Decoder = TYoloDecoder<3, 3, 1>;
+using FYoloCoco640Decoder = TYoloDecoder<3, 3, 80>;
+using FYoloHead1280Decoder = TYoloDecoder<4, 3, 1>;
+using FYoloCoco1280Decoder = TYoloDecoder<4, 3, 80>;
+// Any other class count, e.g. mixed head, hand and phone models
+using FYolo640Decoder = TYoloDecoder<3, 3, 0>;
+using FYolo1280Decoder = TYoloDecoder<4, 3, 0>;
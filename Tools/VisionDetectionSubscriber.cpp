@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Reference subscriber of the detection stream of ACVProcessor (bPublishDetections).
+ * Joins the multicast group, checks every packet against VisionWire.h and prints its detections,
+ * or with -q only the packet counts and the frames missed about once a second.
+ *
+ *   VisionDetectionSubscriber [Group] [Port] [-q]
+ *
+ * Plain C++ without OpenCV, e.g.
+ *   cl /O2 /EHsc /std:c++17 VisionDetectionSubscriber.cpp ws2_32.lib
+ *   g++ -O2 -std=c++17 VisionDetectionSubscriber.cpp -o VisionDetectionSubscriber
+ */
+
+#include "../Source/G_Compile/VisionWire.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+static void CloseSocket(SocketHandle Socket) { closesocket(Socket); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+static const SocketHandle INVALID_SOCKET = -1;
+static void CloseSocket(SocketHandle Socket) { close(Socket); }
+#endif
+
+namespace
+{
+	const char* GetSourceName(uint8_t Source)
+	{
+		switch (static_cast<VisionWire::EDetectionSource>(Source))
+		{
+		case VisionWire::EDetectionSource::Yolov5Head: return "Yolov5Head";
+		case VisionWire::EDetectionSource::Yolov5Track: return "Yolov5Track";
+		case VisionWire::EDetectionSource::Yolov3Body: return "Yolov3Body";
+		case VisionWire::EDetectionSource::SSDResFace: return "SSDResFace";
+		default: return "Unknown";
+		}
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	const char* Group = Argc > 1 ? Argv[1] : VisionWire::DefaultDetectionGroup;
+	const int Port = Argc > 2 ? std::atoi(Argv[2]) : VisionWire::DefaultDetectionPort;
+	const bool bQuiet = Argc > 3 && std::strcmp(Argv[3], "-q") == 0;
+
+#ifdef _WIN32
+	WSADATA Data;
+	WSAStartup(MAKEWORD(2, 2), &Data);
+#endif
+
+	const SocketHandle Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (Socket == INVALID_SOCKET)
+	{
+		std::fprintf(stderr, "Could not create a socket\n");
+		return 1;
+	}
+	// Several subscribers on one machine share the port
+	const int Reuse = 1;
+	setsockopt(Socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&Reuse), sizeof(Reuse));
+	sockaddr_in Address{};
+	Address.sin_family = AF_INET;
+	Address.sin_port = htons(static_cast<uint16_t>(Port));
+	Address.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(Socket, reinterpret_cast<sockaddr*>(&Address), sizeof(Address)) != 0)
+	{
+		std::fprintf(stderr, "Could not bind port %d\n", Port);
+		CloseSocket(Socket);
+		return 1;
+	}
+	ip_mreq Membership{};
+	inet_pton(AF_INET, Group, &Membership.imr_multiaddr);
+	// The publisher sends on loopback, so the group is joined there
+	inet_pton(AF_INET, VisionWire::DetectionInterface, &Membership.imr_interface);
+	if (setsockopt(Socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, reinterpret_cast<const char*>(&Membership), sizeof(Membership)) != 0)
+	{
+		std::fprintf(stderr, "Could not join %s\n", Group);
+		CloseSocket(Socket);
+		return 1;
+	}
+	std::printf("Listening to %s:%d\n", Group, Port);
+
+	using Clock = std::chrono::steady_clock;
+	std::vector<uint8_t> Buffer(65536);
+	uint64_t LastSequence = 0;
+	uint64_t Packets = 0;
+	uint64_t Missed = 0;
+	uint64_t Invalid = 0;
+	Clock::time_point NextReport = Clock::now() + std::chrono::seconds(1);
+	for (;;)
+	{
+		const int Size = recv(Socket, reinterpret_cast<char*>(Buffer.data()), static_cast<int>(Buffer.size()), 0);
+		if (Size < 0) break;
+
+		VisionWire::FDetectionPacketHeader Header;
+		if (Size < static_cast<int>(sizeof(Header)))
+		{
+			++Invalid;
+			continue;
+		}
+		std::memcpy(&Header, Buffer.data(), sizeof(Header));
+		if (Header.Magic != VisionWire::DetectionMagic || Header.Version != VisionWire::DetectionVersion
+			|| Size != static_cast<int>(sizeof(Header) + Header.Count * sizeof(VisionWire::FDetectionRecord)))
+		{
+			++Invalid;
+			continue;
+		}
+		++Packets;
+		// Sequence steps by more than one whenever the pipeline skipped a frame too, so this counts an upper bound
+		if (LastSequence != 0 && Header.Sequence > LastSequence + 1)
+		{
+			Missed += Header.Sequence - LastSequence - 1;
+		}
+		LastSequence = Header.Sequence;
+
+		if (!bQuiet)
+		{
+			std::printf("Frame %llu at %llu us, %u x %u, %u detections\n", static_cast<unsigned long long>(Header.Sequence),
+				static_cast<unsigned long long>(Header.TimestampUs), Header.FrameWidth, Header.FrameHeight, Header.Count);
+			for (uint16_t i = 0; i < Header.Count; ++i)
+			{
+				VisionWire::FDetectionRecord Record;
+				std::memcpy(&Record, Buffer.data() + sizeof(Header) + i * sizeof(Record), sizeof(Record));
+				std::printf("  %-11s id %4d class %3u score %.2f box %.0f %.0f %.0f x %.0f\n", GetSourceName(Record.Source),
+					Record.Id, Record.Class, Record.Score, Record.X, Record.Y, Record.Width, Record.Height);
+			}
+		}
+		if (Clock::now() >= NextReport)
+		{
+			std::printf("%llu packets, %llu frames missed, %llu invalid packets\n", static_cast<unsigned long long>(Packets),
+				static_cast<unsigned long long>(Missed), static_cast<unsigned long long>(Invalid));
+			Packets = 0;
+			NextReport = Clock::now() + std::chrono::seconds(1);
+		}
+		std::fflush(stdout);
+	}
+
+	CloseSocket(Socket);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	return 0;
+}
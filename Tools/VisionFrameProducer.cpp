@@ -0,0 +1,294 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Plays a video file into a shared memory frame ring (see VisionWire.h), the producer side of
+ * ACVProcessor::FrameRingName. Stands in for a capture process in tests: frames are written as
+ * BGR8 at the video's rate, or Fps when given, and the video loops until Seconds are up.
+ *
+ *   VisionFrameProducer <Video> [Name] [Width] [Height] [Fps] [Slots] [Seconds]
+ *   VisionFrameProducer hall.mp4 VisionFrames 1920 1080 30 8
+ *
+ * Width and Height of 0 keep the size of the video. The region is named like Unreal's
+ * MapNamedSharedMemoryRegion names it: Global\<Name> on Windows, which takes an elevated prompt
+ * or a service account to create, and /<Name> elsewhere.
+ *
+ * Build with OpenCV, e.g.
+ *   cl /O2 /EHsc /std:c++17 VisionFrameProducer.cpp /I<opencv>/include <opencv>/lib/opencv_world*.lib
+ *   g++ -O2 -std=c++17 VisionFrameProducer.cpp -o VisionFrameProducer `pkg-config --cflags --libs opencv4` -lrt
+ */
+
+#include "../Source/G_Compile/VisionWire.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::atomic<bool> bQuit{ false };
+
+	uint64_t NowUs()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+	}
+
+	struct FSharedRegion
+	{
+		uint8_t* Data = nullptr;
+		size_t Size = 0;
+		// The mapping was still held by readers of an earlier producer, its header is still in place
+		bool bExisted = false;
+#ifdef _WIN32
+		HANDLE Mapping = nullptr;
+#else
+		std::string Name;
+#endif
+
+		bool Create(const std::string& InName, size_t InSize)
+		{
+			Size = InSize;
+#ifdef _WIN32
+			const std::string Name = "Global\\" + InName;
+			Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+				static_cast<DWORD>(static_cast<uint64_t>(Size) >> 32), static_cast<DWORD>(Size), Name.c_str());
+			if (!Mapping) return false;
+			bExisted = GetLastError() == ERROR_ALREADY_EXISTS;
+			Data = static_cast<uint8_t*>(MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, Size));
+#else
+			Name = "/" + InName;
+			// A fresh region, readers of an old one see it go stale and open this one
+			shm_unlink(Name.c_str());
+			const int File = shm_open(Name.c_str(), O_CREAT | O_RDWR, 0666);
+			if (File < 0) return false;
+			if (ftruncate(File, static_cast<off_t>(Size)) != 0)
+			{
+				close(File);
+				return false;
+			}
+			void* Mapped = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+			close(File);
+			Data = Mapped == MAP_FAILED ? nullptr : static_cast<uint8_t*>(Mapped);
+#endif
+			return Data != nullptr;
+		}
+
+		~FSharedRegion()
+		{
+#ifdef _WIN32
+			if (Data) UnmapViewOfFile(Data);
+			if (Mapping) CloseHandle(Mapping);
+#else
+			if (Data) munmap(Data, Size);
+			if (!Name.empty()) shm_unlink(Name.c_str());
+#endif
+		}
+	};
+
+	// The protocol of VisionWire.h: announce the slot, then skip it when a reader holds it
+	uint32_t BeginWrite(VisionWire::FRingHeader& Header)
+	{
+		const uint32_t Latest = Header.LatestSlot.load();
+		for (uint32_t i = 1; i <= Header.NumSlots; ++i)
+		{
+			const uint32_t Slot = Latest == VisionWire::NoSlot ? i - 1 : (Latest + i) % Header.NumSlots;
+			if (Slot == Latest) continue;
+			Header.WriteSlot.store(Slot);
+			bool bLeased = false;
+			for (uint32_t Reader = 0; Reader < VisionWire::MaxRingReaders; ++Reader)
+			{
+				bLeased |= Header.Leases[Reader].load() == Slot + 1;
+			}
+			if (!bLeased) return Slot;
+		}
+		Header.WriteSlot.store(VisionWire::NoSlot);
+		return VisionWire::NoSlot;
+	}
+
+	void EndWrite(VisionWire::FRingHeader& Header, uint32_t Slot)
+	{
+		Header.WriteSlot.store(VisionWire::NoSlot);
+		Header.LatestSlot.store(Slot);
+		Header.Published.fetch_add(1);
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	if (Argc < 2)
+	{
+		std::fprintf(stderr, "VisionFrameProducer <Video> [Name] [Width] [Height] [Fps] [Slots] [Seconds]\n");
+		return 1;
+	}
+	const char* Video = Argv[1];
+	const std::string Name = Argc > 2 ? Argv[2] : "VisionFrames";
+	int Width = Argc > 3 ? std::atoi(Argv[3]) : 0;
+	int Height = Argc > 4 ? std::atoi(Argv[4]) : 0;
+	double Fps = Argc > 5 ? std::atof(Argv[5]) : 0.0;
+	const int NumSlots = Argc > 6 ? std::atoi(Argv[6]) : 8;
+	const double Seconds = Argc > 7 ? std::atof(Argv[7]) : 0.0;
+	if (NumSlots < static_cast<int>(VisionWire::MaxRingReaders) + 2 || NumSlots > 0xFFFF)
+	{
+		std::fprintf(stderr, "Slots must be at least %u, so every reader can hold a frame\n", VisionWire::MaxRingReaders + 2);
+		return 1;
+	}
+
+	cv::VideoCapture Capture(Video);
+	if (!Capture.isOpened())
+	{
+		std::fprintf(stderr, "Could not open %s\n", Video);
+		return 1;
+	}
+	if (Width <= 0 || Height <= 0)
+	{
+		Width = static_cast<int>(Capture.get(cv::CAP_PROP_FRAME_WIDTH));
+		Height = static_cast<int>(Capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+	}
+	if (Fps <= 0.0)
+	{
+		Fps = Capture.get(cv::CAP_PROP_FPS) > 0.0 ? Capture.get(cv::CAP_PROP_FPS) : 30.0;
+	}
+	if (Width <= 0 || Height <= 0 || Width > 0xFFFF || Height > 0xFFFF)
+	{
+		std::fprintf(stderr, "Frame size %d x %d is not valid\n", Width, Height);
+		return 1;
+	}
+
+	const uint32_t SlotSize = VisionWire::GetRingSlotSize(static_cast<uint32_t>(Width) * Height * 3);
+	FSharedRegion Region;
+	if (!Region.Create(Name, VisionWire::RingHeaderSize + static_cast<size_t>(NumSlots) * SlotSize))
+	{
+		std::fprintf(stderr, "Could not create the shared memory region %s\n", Name.c_str());
+		return 1;
+	}
+
+	// Readers ignore the ring while the magic is cleared, it is set once everything else is in place
+	VisionWire::FRingHeader& Header = *new (Region.Data) VisionWire::FRingHeader;
+	Header.Magic.store(0);
+	uint32_t Generation = 0;
+	if (Region.bExisted)
+	{
+		// Readers of the old header still hold entries and leases, and would read slots at the old
+		// geometry. The cleared magic makes them give those up, nothing is rewritten before they did
+		Generation = Header.Generation.load();
+		const Clock::time_point Deadline = Clock::now() + std::chrono::seconds(5);
+		bool bClaimed = true;
+		while (bClaimed && Clock::now() < Deadline)
+		{
+			bClaimed = false;
+			for (uint32_t Reader = 0; Reader < VisionWire::MaxRingReaders; ++Reader)
+			{
+				bClaimed |= Header.Readers[Reader].load() != 0;
+			}
+			if (bClaimed) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		if (bClaimed)
+		{
+			std::fprintf(stderr, "Readers of %s did not let go of the ring, stop them and start again\n", Name.c_str());
+			return 1;
+		}
+	}
+	Header.Version = VisionWire::RingVersion;
+	Header.NumSlots = static_cast<uint16_t>(NumSlots);
+	Header.SlotSize = SlotSize;
+	Header.Generation.store(Generation + 1);
+	Header.LatestSlot.store(VisionWire::NoSlot);
+	Header.WriteSlot.store(VisionWire::NoSlot);
+	Header.Published.store(0);
+	for (uint32_t Reader = 0; Reader < VisionWire::MaxRingReaders; ++Reader)
+	{
+		Header.Readers[Reader].store(0);
+		Header.Leases[Reader].store(0);
+	}
+	Header.Magic.store(VisionWire::RingMagic);
+
+	std::signal(SIGINT, [](int) { bQuit = true; });
+	std::printf("Playing %s into %s: %d x %d at %.1f fps, %d slots of %u KB\n", Video, Name.c_str(), Width, Height, Fps, NumSlots, SlotSize / 1024);
+
+	cv::Mat Frame;
+	uint64_t Sequence = 0;
+	uint64_t Written = 0;
+	uint64_t Dropped = 0;
+	uint64_t LastWritten = 0;
+	const Clock::time_point Start = Clock::now();
+	const Clock::duration Period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / Fps));
+	Clock::time_point Next = Start;
+	Clock::time_point NextReport = Start + std::chrono::seconds(1);
+	while (!bQuit && (Seconds <= 0.0 || Clock::now() - Start < std::chrono::duration<double>(Seconds)))
+	{
+		if (!Capture.read(Frame))
+		{
+			Capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+			if (!Capture.read(Frame)) break;
+		}
+		++Sequence;
+
+		const uint32_t Slot = BeginWrite(Header);
+		if (Slot == VisionWire::NoSlot)
+		{
+			++Dropped;
+		}
+		else
+		{
+			uint8_t* Data = Region.Data + VisionWire::RingHeaderSize + static_cast<size_t>(Slot) * SlotSize;
+			VisionWire::FFrameHeader& Info = *reinterpret_cast<VisionWire::FFrameHeader*>(Data);
+			Info.Magic = VisionWire::FrameMagic;
+			Info.Version = VisionWire::FrameVersion;
+			Info.Format = static_cast<uint8_t>(VisionWire::EFrameFormat::BGR8);
+			Info.Stream = 0;
+			Info.Width = static_cast<uint16_t>(Width);
+			Info.Height = static_cast<uint16_t>(Height);
+			Info.PayloadSize = static_cast<uint32_t>(Width) * Height * 3;
+			Info.Sequence = Sequence;
+			Info.TimestampUs = NowUs();
+			// Copied into the slot once, the reader uses these pixels in place
+			cv::Mat Pixels(Height, Width, CV_8UC3, Data + VisionWire::RingSlotHeaderSize);
+			if (Frame.cols == Width && Frame.rows == Height)
+			{
+				Frame.copyTo(Pixels);
+			}
+			else
+			{
+				cv::resize(Frame, Pixels, Pixels.size());
+			}
+			EndWrite(Header, Slot);
+			++Written;
+		}
+
+		if (Clock::now() >= NextReport)
+		{
+			int Readers = 0;
+			for (uint32_t Reader = 0; Reader < VisionWire::MaxRingReaders; ++Reader)
+			{
+				Readers += Header.Readers[Reader].load() != 0 ? 1 : 0;
+			}
+			std::printf("%llu fps, %llu dropped, %d readers\n", static_cast<unsigned long long>(Written - LastWritten), static_cast<unsigned long long>(Dropped), Readers);
+			LastWritten = Written;
+			NextReport += std::chrono::seconds(1);
+		}
+		Next += Period;
+		std::this_thread::sleep_until(Next);
+	}
+	std::printf("Wrote %llu frames, %llu dropped\n", static_cast<unsigned long long>(Written), static_cast<unsigned long long>(Dropped));
+	Header.Magic.store(0);
+	return 0;
+}
@@ -0,0 +1,245 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Sends frames to the frame ingest server of ACVProcessor (UseTCP), one connection per stream.
+ * Frames come from a video file, or are synthetic 1080p images when none is given, and are
+ * encoded once up front so the sender measures the receiver rather than itself.
+ *
+ *   VisionFrameSender [Host] [Port] [Streams] [Fps] [Width] [Height] [jpeg|bgr] [Quality] [Seconds] [Video]
+ *   VisionFrameSender 127.0.0.1 9000 4 30 1920 1080 jpeg 90 30
+ *
+ * Build with OpenCV, e.g.
+ *   cl /O2 /EHsc /std:c++17 VisionFrameSender.cpp /I<opencv>/include <opencv>/lib/opencv_world*.lib ws2_32.lib
+ *   g++ -O2 -std=c++17 VisionFrameSender.cpp -o VisionFrameSender `pkg-config --cflags --libs opencv4` -pthread
+ */
+
+#include "../Source/G_Compile/VisionWire.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+static void CloseSocket(SocketHandle Socket) { closesocket(Socket); }
+static const int SendFlags = 0;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+static const SocketHandle INVALID_SOCKET = -1;
+static void CloseSocket(SocketHandle Socket) { close(Socket); }
+// A receiver that goes away fails the send instead of killing the sender with SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int SendFlags = MSG_NOSIGNAL;
+#else
+static const int SendFlags = 0;
+#endif
+#endif
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	uint64_t NowUs()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+	}
+
+	bool SendAll(SocketHandle Socket, const uint8_t* Data, size_t Size)
+	{
+		while (Size > 0)
+		{
+			const int Sent = send(Socket, reinterpret_cast<const char*>(Data), static_cast<int>(Size), SendFlags);
+			if (Sent <= 0) return false;
+			Data += Sent;
+			Size -= Sent;
+		}
+		return true;
+	}
+
+	SocketHandle Connect(const char* Host, int Port)
+	{
+		SocketHandle Socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (Socket == INVALID_SOCKET) return INVALID_SOCKET;
+		const int NoDelay = 1;
+		setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&NoDelay), sizeof(NoDelay));
+#ifdef SO_NOSIGPIPE
+		// No MSG_NOSIGNAL on macOS, the socket option does the same
+		const int NoSigPipe = 1;
+		setsockopt(Socket, SOL_SOCKET, SO_NOSIGPIPE, reinterpret_cast<const char*>(&NoSigPipe), sizeof(NoSigPipe));
+#endif
+		const int BufferSize = 8 * 1024 * 1024;
+		setsockopt(Socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&BufferSize), sizeof(BufferSize));
+		sockaddr_in Address{};
+		Address.sin_family = AF_INET;
+		Address.sin_port = htons(static_cast<uint16_t>(Port));
+		inet_pton(AF_INET, Host, &Address.sin_addr);
+		if (connect(Socket, reinterpret_cast<sockaddr*>(&Address), sizeof(Address)) != 0)
+		{
+			CloseSocket(Socket);
+			return INVALID_SOCKET;
+		}
+		return Socket;
+	}
+
+	// Up to 300 frames of the video, or a few frames of smooth noise that compress about like a camera image
+	std::vector<cv::Mat> LoadFrames(const char* Video, int Width, int Height)
+	{
+		std::vector<cv::Mat> Frames;
+		if (Video)
+		{
+			cv::VideoCapture Capture(Video);
+			cv::Mat Frame;
+			while (Frames.size() < 300 && Capture.read(Frame))
+			{
+				cv::Mat Sized;
+				cv::resize(Frame, Sized, cv::Size(Width, Height));
+				Frames.push_back(Sized);
+			}
+			if (Frames.empty()) std::fprintf(stderr, "Could not read %s, sending synthetic frames\n", Video);
+		}
+		for (int i = 0; Frames.empty() || (!Video && i < 8); ++i)
+		{
+			cv::Mat Small(Height / 8, Width / 8, CV_8UC3);
+			cv::randu(Small, cv::Scalar::all(0), cv::Scalar::all(255));
+			cv::Mat Frame;
+			cv::resize(Small, Frame, cv::Size(Width, Height), 0, 0, cv::INTER_CUBIC);
+			Frames.push_back(Frame);
+		}
+		return Frames;
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	const char* Host = Argc > 1 ? Argv[1] : "127.0.0.1";
+	const int Port = Argc > 2 ? std::atoi(Argv[2]) : VisionWire::DefaultIngestPort;
+	const int Streams = Argc > 3 ? std::atoi(Argv[3]) : 1;
+	const double Fps = Argc > 4 ? std::atof(Argv[4]) : 30.0;
+	const int Width = Argc > 5 ? std::atoi(Argv[5]) : 1920;
+	const int Height = Argc > 6 ? std::atoi(Argv[6]) : 1080;
+	const bool bRaw = Argc > 7 && std::strcmp(Argv[7], "bgr") == 0;
+	const int Quality = Argc > 8 ? std::atoi(Argv[8]) : 90;
+	const double Seconds = Argc > 9 ? std::atof(Argv[9]) : 30.0;
+	const char* Video = Argc > 10 ? Argv[10] : nullptr;
+	if (Streams < 1 || Streams > VisionWire::MaxStreams || Fps <= 0.0 || Width <= 0 || Height <= 0
+		|| Width > static_cast<int>(VisionWire::MaxFrameWidth) || Height > static_cast<int>(VisionWire::MaxFrameHeight))
+	{
+		std::fprintf(stderr, "Streams must be 1 to %d, Fps above 0, Width and Height 1 to %u x %u\n",
+			VisionWire::MaxStreams, VisionWire::MaxFrameWidth, VisionWire::MaxFrameHeight);
+		return 1;
+	}
+
+#ifdef _WIN32
+	WSADATA Data;
+	WSAStartup(MAKEWORD(2, 2), &Data);
+#endif
+
+	std::vector<std::vector<uchar>> Payloads;
+	size_t TotalBytes = 0;
+	for (const cv::Mat& Frame : LoadFrames(Video, Width, Height))
+	{
+		std::vector<uchar> Payload;
+		if (bRaw)
+		{
+			Payload.assign(Frame.data, Frame.data + Frame.total() * Frame.elemSize());
+		}
+		else
+		{
+			cv::imencode(".jpg", Frame, Payload, { cv::IMWRITE_JPEG_QUALITY, Quality });
+		}
+		TotalBytes += Payload.size();
+		Payloads.push_back(std::move(Payload));
+	}
+	std::printf("Sending %zu frames of %d x %d %s (%.0f KB avg) to %s:%d, %d streams at %.1f fps for %.0f s\n",
+		Payloads.size(), Width, Height, bRaw ? "BGR" : "JPEG", TotalBytes / 1024.0 / Payloads.size(), Host, Port, Streams, Fps, Seconds);
+
+	std::atomic<uint64_t> SentFrames{ 0 };
+	std::atomic<uint64_t> SentBytes{ 0 };
+	std::atomic<uint64_t> LateFrames{ 0 };
+	const Clock::time_point End = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(Seconds));
+	std::vector<std::thread> Senders;
+	for (int Stream = 0; Stream < Streams; ++Stream)
+	{
+		Senders.emplace_back([&, Stream]()
+		{
+			const SocketHandle Socket = Connect(Host, Port);
+			if (Socket == INVALID_SOCKET)
+			{
+				std::fprintf(stderr, "Stream %d could not connect\n", Stream);
+				return;
+			}
+			VisionWire::FFrameHeader Header{};
+			Header.Magic = VisionWire::FrameMagic;
+			Header.Version = VisionWire::FrameVersion;
+			Header.Format = static_cast<uint8_t>(bRaw ? VisionWire::EFrameFormat::BGR8 : VisionWire::EFrameFormat::Jpeg);
+			Header.Stream = static_cast<uint8_t>(Stream);
+			Header.Width = static_cast<uint16_t>(Width);
+			Header.Height = static_cast<uint16_t>(Height);
+			const Clock::duration Period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / Fps));
+			Clock::time_point Next = Clock::now();
+			while (Clock::now() < End)
+			{
+				const std::vector<uchar>& Payload = Payloads[Header.Sequence % Payloads.size()];
+				++Header.Sequence;
+				Header.TimestampUs = NowUs();
+				Header.PayloadSize = static_cast<uint32_t>(Payload.size());
+				if (!SendAll(Socket, reinterpret_cast<const uint8_t*>(&Header), sizeof(Header)) || !SendAll(Socket, Payload.data(), Payload.size()))
+				{
+					std::fprintf(stderr, "Stream %d disconnected\n", Stream);
+					break;
+				}
+				SentFrames.fetch_add(1);
+				SentBytes.fetch_add(sizeof(Header) + Payload.size());
+				Next += Period;
+				if (Clock::now() > Next)
+				{
+					LateFrames.fetch_add(1);
+					Next = Clock::now();
+				}
+				std::this_thread::sleep_until(Next);
+			}
+			CloseSocket(Socket);
+		});
+	}
+
+	const Clock::time_point Start = Clock::now();
+	uint64_t LastFrames = 0;
+	uint64_t LastBytes = 0;
+	while (Clock::now() < End)
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		const uint64_t Frames = SentFrames.load();
+		const uint64_t Bytes = SentBytes.load();
+		std::printf("%.0f s: %llu fps, %.1f MB/s, %llu late\n", std::chrono::duration<double>(Clock::now() - Start).count(),
+			static_cast<unsigned long long>(Frames - LastFrames), (Bytes - LastBytes) / (1024.0 * 1024.0), static_cast<unsigned long long>(LateFrames.load()));
+		LastFrames = Frames;
+		LastBytes = Bytes;
+	}
+	for (std::thread& Sender : Senders)
+	{
+		Sender.join();
+	}
+	std::printf("Sent %llu frames, %.1f MB\n", static_cast<unsigned long long>(SentFrames.load()), SentBytes.load() / (1024.0 * 1024.0));
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	return 0;
+}